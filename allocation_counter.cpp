@@ -0,0 +1,31 @@
+#include "allocation_counter.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+std::atomic<uint64_t> allocation_count = 0;
+
+}
+
+uint64_t GetAllocationCount() {
+	return allocation_count.load(std::memory_order_relaxed);
+}
+
+void* operator new(size_t size) {
+	allocation_count.fetch_add(1, std::memory_order_relaxed);
+	if (void* result = std::malloc(size == 0 ? 1 : size)) {
+		return result;
+	}
+	throw std::bad_alloc();
+}
+
+void operator delete(void* pointer) noexcept {
+	std::free(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept {
+	std::free(pointer);
+}
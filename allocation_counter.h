@@ -0,0 +1,7 @@
+#pragma once
+
+#include <cstdint>
+
+// Число вызовов глобального operator new с начала работы программы.
+// Замена operator new подключается только к тем программам, в которые слинкован allocation_counter.o.
+uint64_t GetAllocationCount();
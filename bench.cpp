@@ -0,0 +1,400 @@
+#include "search_server.h"
+#include "process_queries.h"
+#include "query_generator.h"
+#include "latency_stats.h"
+#include "allocation_counter.h"
+#include "document_loader.h"
+#include "durable_search_server.h"
+
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <execution>
+#include <random>
+
+using namespace std;
+
+namespace {
+
+struct BenchmarkConfig {
+    unsigned seed = 42;
+    int dictionary_size = 5'000;
+    int max_word_length = 10;
+    int document_count = 10'000;
+    int document_words = 70;
+    int query_count = 1'000;
+    int query_words = 5;
+    double zipf_exponent = 1.0;
+    double minus_prob = 0.1;
+    int batch_size = 100;
+    string output = "bench_results.json"s;
+};
+
+struct BenchmarkResult {
+    string name;
+    size_t operations = 0;
+    size_t operations_per_sample = 1;
+    chrono::nanoseconds wall_time{0};
+    uint64_t allocations = 0;
+    // обработанный объём входных данных, если он имеет смысл для операции
+    size_t bytes = 0;
+    LatencyRecorder latencies;
+};
+
+// operation(i) вызывается sample_count раз, каждый вызов — operations_per_sample операций
+template <typename Operation>
+BenchmarkResult Measure(const string& name, size_t sample_count, size_t operations_per_sample, Operation operation) {
+    using Clock = chrono::steady_clock;
+    BenchmarkResult result;
+    result.name = name;
+    result.operations = sample_count * operations_per_sample;
+    result.operations_per_sample = operations_per_sample;
+    result.latencies.Reserve(sample_count);
+    const uint64_t allocations_before = GetAllocationCount();
+    const auto start_time = Clock::now();
+    for (size_t i = 0; i < sample_count; ++i) {
+        const auto operation_start = Clock::now();
+        operation(i);
+        result.latencies.Add(Clock::now() - operation_start);
+    }
+    result.wall_time = Clock::now() - start_time;
+    result.allocations = GetAllocationCount() - allocations_before;
+    cerr << name << ": "s << result.operations << " ops, p50 = "s << result.latencies.GetPercentile(0.5).count() << " ns"s << endl;
+    return result;
+}
+
+BenchmarkConfig ParseArguments(int argc, char* argv[]) {
+    BenchmarkConfig config;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        const string_view key = argv[i];
+        const string value = argv[i + 1];
+        if (key == "--seed"sv) {
+            config.seed = stoul(value);
+        } else if (key == "--dictionary-size"sv) {
+            config.dictionary_size = stoi(value);
+        } else if (key == "--max-word-length"sv) {
+            config.max_word_length = stoi(value);
+        } else if (key == "--documents"sv) {
+            config.document_count = stoi(value);
+        } else if (key == "--document-words"sv) {
+            config.document_words = stoi(value);
+        } else if (key == "--queries"sv) {
+            config.query_count = stoi(value);
+        } else if (key == "--query-words"sv) {
+            config.query_words = stoi(value);
+        } else if (key == "--zipf"sv) {
+            config.zipf_exponent = stod(value);
+        } else if (key == "--minus-prob"sv) {
+            config.minus_prob = stod(value);
+        } else if (key == "--batch-size"sv) {
+            config.batch_size = max(1, stoi(value));
+        } else if (key == "--output"sv) {
+            config.output = value;
+        } else {
+            throw invalid_argument("Unknown option "s + string(key));
+        }
+    }
+    return config;
+}
+
+void WriteMemoryUsage(ostream& out, const SearchServer::MemoryUsage& memory) {
+    out << "{\"stop_words\": "s << memory.stop_words
+        << ", \"term_dictionary\": "s << memory.term_dictionary
+        << ", \"postings\": "s << memory.postings
+        << ", \"forward_index\": "s << memory.forward_index
+        << ", \"positions\": "s << memory.positions
+        << ", \"documents\": "s << memory.documents
+        << ", \"total\": "s << memory.GetTotal() << "}"s;
+}
+
+void WriteJson(ostream& out, const BenchmarkConfig& config, const vector<BenchmarkResult>& results, const string& server_metrics,
+               const SearchServer::MemoryUsage& default_memory, const SearchServer::MemoryUsage& compact_memory,
+               const SearchServer::MemoryUsage& positional_memory) {
+    out << fixed << setprecision(3);
+    out << "{\n  \"config\": {"s
+        << "\"seed\": "s << config.seed
+        << ", \"dictionary_size\": "s << config.dictionary_size
+        << ", \"max_word_length\": "s << config.max_word_length
+        << ", \"documents\": "s << config.document_count
+        << ", \"document_words\": "s << config.document_words
+        << ", \"queries\": "s << config.query_count
+        << ", \"query_words\": "s << config.query_words
+        << ", \"zipf_exponent\": "s << config.zipf_exponent
+        << ", \"minus_prob\": "s << config.minus_prob
+        << ", \"batch_size\": "s << config.batch_size << "},\n"s;
+    out << "  \"results\": [\n"s;
+    for (size_t i = 0; i < results.size(); ++i) {
+        const BenchmarkResult& result = results[i];
+        const double seconds = chrono::duration<double>(result.wall_time).count();
+        out << "    {\"name\": \""s << result.name << "\""s
+            << ", \"operations\": "s << result.operations
+            << ", \"operations_per_sample\": "s << result.operations_per_sample
+            << ", \"throughput_ops_per_sec\": "s << (seconds > 0 ? result.operations / seconds : 0.0)
+            << (result.bytes > 0 ? ", \"throughput_mb_per_sec\": "s + to_string(seconds > 0 ? result.bytes / 1e6 / seconds : 0.0) : ""s)
+            << ", \"allocations_per_op\": "s << static_cast<double>(result.allocations) / max<size_t>(result.operations, 1)
+            << ", \"latency_ns\": {\"mean\": "s << result.latencies.GetMean().count()
+            << ", \"p50\": "s << result.latencies.GetPercentile(0.5).count()
+            << ", \"p99\": "s << result.latencies.GetPercentile(0.99).count()
+            << ", \"p999\": "s << result.latencies.GetPercentile(0.999).count() << "}}"s
+            << (i + 1 < results.size() ? ",\n"s : "\n"s);
+    }
+    out << "  ],\n  \"memory_bytes\": {\"default\": "s;
+    WriteMemoryUsage(out, default_memory);
+    out << ", \"compact\": "s;
+    WriteMemoryUsage(out, compact_memory);
+    out << ", \"positional\": "s;
+    WriteMemoryUsage(out, positional_memory);
+    out << "},\n  \"server_metrics\": "s << server_metrics << "\n}\n"s;
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    const BenchmarkConfig config = ParseArguments(argc, argv);
+    mt19937 generator(config.seed);
+
+    const auto dictionary = GenerateDictionary(generator, config.dictionary_size, config.max_word_length);
+    const WordSampler sampler(dictionary, config.zipf_exponent);
+    const auto documents = GenerateQueries(generator, sampler, config.document_count, config.document_words);
+    const auto queries = GenerateQueries(generator, sampler, config.query_count, config.query_words, config.minus_prob);
+    const auto IsActual = [](int, DocumentStatus status, int) {
+        return status == DocumentStatus::ACTUAL;
+    };
+    const auto IsEven = [](int document_id, DocumentStatus, int) {
+        return document_id % 2 == 0;
+    };
+
+    vector<BenchmarkResult> results;
+    SearchServer search_server(dictionary[0]);
+    results.push_back(Measure("add_document"s, documents.size(), 1, [&](size_t i) {
+        search_server.AddDocument(i, documents[i], DocumentStatus::ACTUAL, {1, 2, 3});
+    }));
+
+    // те же документы одним буфером через конвейер загрузки
+    string documents_text;
+    for (const string& document : documents) {
+        documents_text += document;
+        documents_text += '\n';
+    }
+    {
+        SearchServer ingest_server(dictionary[0]);
+        IngestStats ingest_stats;
+        BenchmarkResult result = Measure("ingest_documents"s, 1, documents.size(), [&](size_t) {
+            ingest_stats = IngestDocuments(ingest_server, documents_text);
+        });
+        cerr << ingest_stats << endl;
+        result.bytes = documents_text.size();
+        results.push_back(move(result));
+    }
+    // те же документы через журнал изменений и восстановление индекса из него
+    {
+        const string log_path = config.output + ".wal"s;
+        const string snapshot_path = config.output + ".snapshot"s;
+        remove(log_path.c_str());
+        remove(snapshot_path.c_str());
+        {
+            DurableSearchServer durable_server(snapshot_path, log_path, SearchServer(dictionary[0]));
+            results.push_back(Measure("durable_add_document"s, documents.size(), 1, [&](size_t i) {
+                durable_server.AddDocument(i, documents[i], DocumentStatus::ACTUAL, {1, 2, 3});
+            }));
+        }
+        BenchmarkResult result = Measure("wal_recovery"s, 1, documents.size(), [&](size_t) {
+            DurableSearchServer recovered(snapshot_path, log_path, SearchServer(dictionary[0]));
+        });
+        result.bytes = documents_text.size();
+        results.push_back(move(result));
+        remove(log_path.c_str());
+    }
+
+    volatile size_t sink = 0;
+    results.push_back(Measure("find_top_documents_seq"s, queries.size(), 1, [&](size_t i) {
+        sink = sink + search_server.FindTopDocuments(execution::seq, queries[i]).size();
+    }));
+    results.push_back(Measure("find_top_documents_par"s, queries.size(), 1, [&](size_t i) {
+        sink = sink + search_server.FindTopDocuments(execution::par, queries[i]).size();
+    }));
+    results.push_back(Measure("find_top_documents_status"s, queries.size(), 1, [&](size_t i) {
+        sink = sink + search_server.FindTopDocuments(queries[i], DocumentStatus::ACTUAL).size();
+    }));
+    results.push_back(Measure("find_top_documents_lambda_status"s, queries.size(), 1, [&](size_t i) {
+        sink = sink + search_server.FindTopDocuments(queries[i], IsActual).size();
+    }));
+    results.push_back(Measure("find_top_documents_predicate"s, queries.size(), 1, [&](size_t i) {
+        sink = sink + search_server.FindTopDocuments(queries[i], IsEven).size();
+    }));
+    // те же условия, что у лямбд выше, но распознаваемые сервером на этапе компиляции
+    results.push_back(Measure("find_top_documents_accept_all"s, queries.size(), 1, [&](size_t i) {
+        sink = sink + search_server.FindTopDocuments(queries[i], AcceptAll()).size();
+    }));
+    results.push_back(Measure("find_top_documents_lambda_accept_all"s, queries.size(), 1, [&](size_t i) {
+        sink = sink + search_server.FindTopDocuments(queries[i], [](int, DocumentStatus, int) {
+            return true;
+        }).size();
+    }));
+    results.push_back(Measure("find_top_documents_rating_at_least"s, queries.size(), 1, [&](size_t i) {
+        sink = sink + search_server.FindTopDocuments(queries[i], RatingAtLeast<2>()).size();
+    }));
+    results.push_back(Measure("find_top_documents_lambda_rating_at_least"s, queries.size(), 1, [&](size_t i) {
+        sink = sink + search_server.FindTopDocuments(queries[i], [](int, DocumentStatus, int rating) {
+            return rating >= 2;
+        }).size();
+    }));
+
+    results.push_back(Measure("find_top_documents_bm25"s, queries.size(), 1, [&](size_t i) {
+        sink = sink + search_server.FindTopDocuments<Bm25>(execution::seq, queries[i]).size();
+    }));
+    results.push_back(Measure("find_top_documents_bm25_par"s, queries.size(), 1, [&](size_t i) {
+        sink = sink + search_server.FindTopDocuments<Bm25>(execution::par, queries[i]).size();
+    }));
+
+    // те же запросы без минус-слов: только на них работает отсечение MaxScore.
+    // plus_words_all ранжирует все найденные документы и показывает, сколько отсечение экономит
+    vector<string> plus_word_queries;
+    for (const string& query : queries) {
+        string plus_word_query;
+        for (const string_view word : SplitIntoWords(query)) {
+            if (word[0] != '-') {
+                plus_word_query += (plus_word_query.empty() ? ""s : " "s) + string(word);
+            }
+        }
+        plus_word_queries.push_back(move(plus_word_query));
+    }
+    results.push_back(Measure("find_top_documents_plus_words"s, plus_word_queries.size(), 1, [&](size_t i) {
+        sink = sink + search_server.FindTopDocuments(plus_word_queries[i]).size();
+    }));
+    results.push_back(Measure("find_top_documents_plus_words_bm25"s, plus_word_queries.size(), 1, [&](size_t i) {
+        sink = sink + search_server.FindTopDocuments<Bm25>(plus_word_queries[i]).size();
+    }));
+    results.push_back(Measure("find_top_documents_plus_words_all"s, plus_word_queries.size(), 1, [&](size_t i) {
+        auto cursor = search_server.FindDocumentPages(plus_word_queries[i], MAX_RESULT_DOCUMENT_COUNT);
+        sink = sink + cursor.NextPage().size();
+    }));
+
+    // те же запросы, но все плюс-слова обязательны
+    vector<string> required_queries;
+    for (const string& query : queries) {
+        string required_query;
+        for (const string_view word : SplitIntoWords(query)) {
+            required_query += (required_query.empty() ? ""s : " "s) + (word[0] == '-' || word == dictionary[0] ? ""s : "+"s) + string(word);
+        }
+        required_queries.push_back(move(required_query));
+    }
+    results.push_back(Measure("find_top_documents_required"s, required_queries.size(), 1, [&](size_t i) {
+        sink = sink + search_server.FindTopDocuments(required_queries[i]).size();
+    }));
+
+    // запросы автодополнения: начало случайного слова словаря.
+    // У выборки свой генератор, чтобы она не сдвигала случайные данные остальных замеров
+    mt19937 prefix_generator(config.seed + 2);
+    uniform_int_distribution<size_t> dictionary_word(0, dictionary.size() - 1);
+    for (const size_t prefix_length : {1, 2, 3}) {
+        vector<string> prefix_queries(queries.size());
+        for (string& query : prefix_queries) {
+            query = dictionary[dictionary_word(prefix_generator)].substr(0, prefix_length) + "*"s;
+        }
+        results.push_back(Measure("find_top_documents_prefix_"s + to_string(prefix_length), prefix_queries.size(), 1, [&](size_t i) {
+            sink = sink + search_server.FindTopDocuments(prefix_queries[i]).size();
+        }));
+    }
+
+    uniform_int_distribution<int> document_id(0, config.document_count - 1);
+    vector<int> match_ids(queries.size());
+    for (int& id : match_ids) {
+        id = document_id(generator);
+    }
+    results.push_back(Measure("match_document_seq"s, queries.size(), 1, [&](size_t i) {
+        sink = sink + get<0>(search_server.MatchDocument(execution::seq, queries[i], match_ids[i])).size();
+    }));
+    results.push_back(Measure("match_document_par"s, queries.size(), 1, [&](size_t i) {
+        sink = sink + get<0>(search_server.MatchDocument(execution::par, queries[i], match_ids[i])).size();
+    }));
+
+    const size_t batch_count = (queries.size() + config.batch_size - 1) / config.batch_size;
+    vector<vector<string>> batches(batch_count);
+    for (size_t i = 0; i < queries.size(); ++i) {
+        batches[i / config.batch_size].push_back(queries[i]);
+    }
+    results.push_back(Measure("process_queries"s, batch_count, config.batch_size, [&](size_t i) {
+        sink = sink + ProcessQueries(search_server, batches[i]).size();
+    }));
+    results.push_back(Measure("process_queries_joined"s, batch_count, config.batch_size, [&](size_t i) {
+        sink = sink + ProcessQueriesJoined(search_server, batches[i]).size();
+    }));
+
+    // тот же корпус без прямого индекса
+    SearchServer compact_server(dictionary[0], IndexOptions::Compact());
+    for (size_t i = 0; i < documents.size(); ++i) {
+        compact_server.AddDocument(i, documents[i], DocumentStatus::ACTUAL, {1, 2, 3});
+    }
+    search_server.ShrinkToFit();
+    compact_server.ShrinkToFit();
+    const SearchServer::MemoryUsage default_memory = search_server.GetMemoryUsage();
+    const SearchServer::MemoryUsage compact_memory = compact_server.GetMemoryUsage();
+
+    IndexOptions positional_options;
+    positional_options.positions = true;
+    SearchServer positional_server(dictionary[0], positional_options);
+    for (size_t i = 0; i < documents.size(); ++i) {
+        positional_server.AddDocument(i, documents[i], DocumentStatus::ACTUAL, {1, 2, 3});
+    }
+    positional_server.ShrinkToFit();
+    const SearchServer::MemoryUsage positional_memory = positional_server.GetMemoryUsage();
+    cerr << "memory: default = "s << default_memory.GetTotal() << " bytes, compact = "s << compact_memory.GetTotal()
+         << " bytes, positional = "s << positional_memory.GetTotal() << " bytes"s << endl;
+
+    // фразы из двух соседних слов случайных документов и те же слова без кавычек.
+    // У выборки свой генератор, чтобы она не сдвигала случайные данные остальных замеров
+    mt19937 phrase_generator(config.seed + 1);
+    vector<string> phrase_queries;
+    vector<string> phrase_word_queries;
+    uniform_int_distribution<size_t> phrase_document(0, documents.size() - 1);
+    for (size_t i = 0; i < queries.size(); ++i) {
+        const auto words = SplitIntoWords(documents[phrase_document(phrase_generator)]);
+        const size_t start = uniform_int_distribution<size_t>(0, words.size() - 2)(phrase_generator);
+        const string phrase = string(words[start]) + " "s + string(words[start + 1]);
+        phrase_queries.push_back("\""s + phrase + "\""s);
+        phrase_word_queries.push_back(phrase);
+    }
+    results.push_back(Measure("find_top_documents_phrase"s, phrase_queries.size(), 1, [&](size_t i) {
+        sink = sink + positional_server.FindTopDocuments(phrase_queries[i]).size();
+    }));
+    results.push_back(Measure("find_top_documents_phrase_words"s, phrase_word_queries.size(), 1, [&](size_t i) {
+        sink = sink + positional_server.FindTopDocuments(phrase_word_queries[i]).size();
+    }));
+
+    // счётчики запросов общие для всего процесса, размеры индекса — только этого сервера
+    ostringstream server_metrics;
+    server_metrics << "{\"process_queries\": "s;
+    CollectMetrics().Print(server_metrics, MetricsFormat::JSON);
+    server_metrics << ", \"index\": "s;
+    search_server.ExportIndexGauges(server_metrics, MetricsFormat::JSON);
+    server_metrics << "}"s;
+
+    vector<int> remove_ids(documents.size());
+    iota(remove_ids.begin(), remove_ids.end(), 0);
+    shuffle(remove_ids.begin(), remove_ids.end(), generator);
+    {
+        SearchServer server_copy = search_server;
+        results.push_back(Measure("remove_document_seq"s, remove_ids.size(), 1, [&](size_t i) {
+            server_copy.RemoveDocument(execution::seq, remove_ids[i]);
+        }));
+    }
+    {
+        SearchServer server_copy = search_server;
+        results.push_back(Measure("remove_document_par"s, remove_ids.size(), 1, [&](size_t i) {
+            server_copy.RemoveDocument(execution::par, remove_ids[i]);
+        }));
+    }
+    results.push_back(Measure("remove_document_compact"s, remove_ids.size(), 1, [&](size_t i) {
+        compact_server.RemoveDocument(remove_ids[i]);
+    }));
+
+    ofstream out(config.output);
+    WriteJson(out, config, results, server_metrics.str(), default_memory, compact_memory, positional_memory);
+    cerr << "results written to "s << config.output << endl;
+}
@@ -40,10 +40,10 @@ public:
         return {maps_[index], key};
     }
 
-    void erase(const Key& key) {
+    size_t erase(const Key& key) {
         const size_t index = key % maps_.size();
         std::lock_guard guard(maps_[index].map_mutex);
-        maps_[index].map.erase(key);
+        return maps_[index].map.erase(key);
     }
 
     std::map<Key, Value> BuildOrdinaryMap() {
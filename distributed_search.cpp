@@ -0,0 +1,674 @@
+#include "distributed_search.h"
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+// ответы и запросы — десятки байт на документ или слово; длина больше этой — повреждённый кадр
+const uint32_t MAX_FRAME_SIZE = 16 << 20;
+
+enum class RequestType : uint8_t {
+	STATISTICS = 1,
+	SEARCH = 2,
+	MATCH = 3,
+};
+
+enum class ResponseCode : uint8_t {
+	OK = 0,
+	NOT_FOUND = 1,
+	INVALID_QUERY = 2,
+	// лист не смог разобрать или выполнить запрос целиком: кадр содержит только этот код и текст ошибки
+	INTERNAL_ERROR = 3,
+};
+
+class ByteWriter {
+public:
+	void PutU8(uint8_t value) {
+		buffer_.push_back(static_cast<char>(value));
+	}
+
+	void PutU32(uint32_t value) {
+		for (int i = 0; i < 4; ++i) {
+			PutU8((value >> (8 * i)) & 0xFF);
+		}
+	}
+
+	void PutI32(int32_t value) {
+		PutU32(static_cast<uint32_t>(value));
+	}
+
+	void PutU64(uint64_t value) {
+		PutU32(value & UINT32_MAX);
+		PutU32(value >> 32);
+	}
+
+	void PutDouble(double value) {
+		uint64_t bits;
+		std::memcpy(&bits, &value, sizeof(bits));
+		PutU64(bits);
+	}
+
+	void PutString(std::string_view value) {
+		PutU32(value.size());
+		buffer_.append(value);
+	}
+
+	std::string& GetBuffer() {
+		return buffer_;
+	}
+
+private:
+	std::string buffer_;
+};
+
+class ByteReader {
+public:
+	explicit ByteReader(std::string_view data) : data_(data) {
+	}
+
+	uint8_t GetU8() {
+		Require(1);
+		const uint8_t result = static_cast<uint8_t>(data_[0]);
+		data_.remove_prefix(1);
+		return result;
+	}
+
+	uint32_t GetU32() {
+		uint32_t result = 0;
+		for (int i = 0; i < 4; ++i) {
+			result |= static_cast<uint32_t>(GetU8()) << (8 * i);
+		}
+		return result;
+	}
+
+	int32_t GetI32() {
+		return static_cast<int32_t>(GetU32());
+	}
+
+	uint64_t GetU64() {
+		const uint64_t low = GetU32();
+		return low | (static_cast<uint64_t>(GetU32()) << 32);
+	}
+
+	double GetDouble() {
+		const uint64_t bits = GetU64();
+		double result;
+		std::memcpy(&result, &bits, sizeof(result));
+		return result;
+	}
+
+	// число элементов не может превышать оставшиеся байты, делённые на минимальный размер элемента,
+	// иначе испорченный счётчик привёл бы к огромному выделению памяти
+	uint32_t GetCount(size_t min_element_size) {
+		const uint32_t count = GetU32();
+		if (count > data_.size() / min_element_size) {
+			throw std::runtime_error("Corrupt element count"s);
+		}
+		return count;
+	}
+
+	std::string_view GetString() {
+		const uint32_t size = GetU32();
+		Require(size);
+		const std::string_view result = data_.substr(0, size);
+		data_.remove_prefix(size);
+		return result;
+	}
+
+private:
+	void Require(size_t size) const {
+		if (data_.size() < size) {
+			throw std::runtime_error("Truncated message"s);
+		}
+	}
+
+	std::string_view data_;
+};
+
+// байт статуса приходит из сети, поэтому проверяется до приведения к DocumentStatus
+DocumentStatus GetStatus(ByteReader& reader) {
+	const uint8_t status = reader.GetU8();
+	if (status > static_cast<uint8_t>(DocumentStatus::REMOVED)) {
+		throw std::runtime_error("Invalid document status "s + std::to_string(status));
+	}
+	return static_cast<DocumentStatus>(status);
+}
+
+RankerType GetRanker(ByteReader& reader) {
+	const uint8_t ranker = reader.GetU8();
+	if (ranker != static_cast<uint8_t>(RankerType::TF_IDF) && ranker != static_cast<uint8_t>(RankerType::BM25)) {
+		throw std::runtime_error("Invalid ranker "s + std::to_string(ranker));
+	}
+	return static_cast<RankerType>(ranker);
+}
+
+void PutStatistics(ByteWriter& writer, const SearchServer::TermStatistics& statistics) {
+	writer.PutI32(statistics.document_count);
+	writer.PutU64(statistics.total_document_length);
+	writer.PutU32(statistics.document_freqs.size());
+	for (const auto& [word, document_freq] : statistics.document_freqs) {
+		writer.PutString(word);
+		writer.PutI32(document_freq);
+	}
+	writer.PutU32(statistics.prefix_words.size());
+	for (const auto& [prefix, words] : statistics.prefix_words) {
+		writer.PutString(prefix);
+		writer.PutU32(words.size());
+		for (const std::string& word : words) {
+			writer.PutString(word);
+		}
+	}
+}
+
+SearchServer::TermStatistics GetStatistics(ByteReader& reader) {
+	SearchServer::TermStatistics result;
+	result.document_count = reader.GetI32();
+	result.total_document_length = reader.GetU64();
+	for (uint32_t i = reader.GetU32(); i > 0; --i) {
+		const std::string_view word = reader.GetString();
+		result.document_freqs.emplace(word, reader.GetI32());
+	}
+	for (uint32_t i = reader.GetU32(); i > 0; --i) {
+		auto& words = result.prefix_words[std::string(reader.GetString())];
+		for (uint32_t j = reader.GetU32(); j > 0; --j) {
+			words.emplace_back(reader.GetString());
+		}
+	}
+	return result;
+}
+
+using Deadline = std::chrono::steady_clock::time_point;
+
+int ParseAddress(const std::string& address, sockaddr_storage& storage, socklen_t& length) {
+	std::memset(&storage, 0, sizeof(storage));
+	if (address.rfind("unix:"s, 0) == 0) {
+		auto& unix_address = reinterpret_cast<sockaddr_un&>(storage);
+		const std::string path = address.substr(5);
+		if (path.empty() || path.size() >= sizeof(unix_address.sun_path)) {
+			throw std::invalid_argument("Invalid socket path "s + path);
+		}
+		unix_address.sun_family = AF_UNIX;
+		std::memcpy(unix_address.sun_path, path.data(), path.size());
+		length = sizeof(sockaddr_un);
+		return AF_UNIX;
+	}
+	if (address.rfind("tcp:"s, 0) == 0) {
+		auto& inet_address = reinterpret_cast<sockaddr_in&>(storage);
+		const size_t colon = address.rfind(':');
+		const std::string host = address.substr(4, colon - 4);
+		inet_address.sin_family = AF_INET;
+		inet_address.sin_port = htons(std::stoi(address.substr(colon + 1)));
+		if (colon <= 4 || inet_pton(AF_INET, host.c_str(), &inet_address.sin_addr) != 1) {
+			throw std::invalid_argument("Invalid address "s + address);
+		}
+		length = sizeof(sockaddr_in);
+		return AF_INET;
+	}
+	throw std::invalid_argument("Unknown address scheme "s + address);
+}
+
+bool WaitFor(int connection, short events, Deadline deadline) {
+	int timeout = -1;
+	if (deadline != Deadline::max()) {
+		// после дедлайна уже пришедшие данные ещё можно забрать без ожидания
+		const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+		timeout = static_cast<int>(std::clamp<int64_t>(left.count(), 0, INT_MAX));
+	}
+	pollfd descriptor{connection, events, 0};
+	return poll(&descriptor, 1, timeout) > 0;
+}
+
+bool SendAll(int connection, std::string_view data, Deadline deadline) {
+	while (!data.empty()) {
+		if (!WaitFor(connection, POLLOUT, deadline)) {
+			return false;
+		}
+		const ssize_t sent = send(connection, data.data(), data.size(), MSG_NOSIGNAL);
+		if (sent < 0 && errno == EINTR) {
+			continue;
+		}
+		if (sent <= 0) {
+			return false;
+		}
+		data.remove_prefix(sent);
+	}
+	return true;
+}
+
+bool ReceiveAll(int connection, char* data, size_t size, Deadline deadline) {
+	while (size > 0) {
+		if (!WaitFor(connection, POLLIN, deadline)) {
+			return false;
+		}
+		const ssize_t received = recv(connection, data, size, 0);
+		if (received < 0 && errno == EINTR) {
+			continue;
+		}
+		if (received <= 0) {
+			return false;
+		}
+		data += received;
+		size -= received;
+	}
+	return true;
+}
+
+// кадр: длина (4 байта, little-endian) и тело
+bool SendFrame(int connection, std::string& payload, Deadline deadline) {
+	ByteWriter header;
+	header.PutU32(payload.size());
+	return SendAll(connection, header.GetBuffer(), deadline) && SendAll(connection, payload, deadline);
+}
+
+bool ReceiveFrame(int connection, std::string& payload, Deadline deadline) {
+	char header[4];
+	if (!ReceiveAll(connection, header, sizeof(header), deadline)) {
+		return false;
+	}
+	const uint32_t size = ByteReader(std::string_view(header, sizeof(header))).GetU32();
+	if (size > MAX_FRAME_SIZE) {
+		return false;
+	}
+	payload.resize(size);
+	return ReceiveAll(connection, payload.data(), payload.size(), deadline);
+}
+
+// неблокирующее подключение: возвращает сокет, подключение к которому завершает FinishConnect, или -1
+int StartConnect(const std::string& address) {
+	sockaddr_storage storage;
+	socklen_t length;
+	const int family = ParseAddress(address, storage, length);
+	const int connection = socket(family, SOCK_STREAM, 0);
+	if (connection < 0) {
+		return -1;
+	}
+	const int flags = fcntl(connection, F_GETFL);
+	if (flags < 0 || fcntl(connection, F_SETFL, flags | O_NONBLOCK) < 0
+		|| (connect(connection, reinterpret_cast<sockaddr*>(&storage), length) < 0 && errno != EINPROGRESS && errno != EAGAIN)) {
+		close(connection);
+		return -1;
+	}
+	if (family == AF_INET) {
+		const int enable = 1;
+		setsockopt(connection, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+	}
+	return connection;
+}
+
+bool FinishConnect(int connection, Deadline deadline) {
+	int error = 0;
+	socklen_t error_length = sizeof(error);
+	if (!WaitFor(connection, POLLOUT, deadline) || getsockopt(connection, SOL_SOCKET, SO_ERROR, &error, &error_length) < 0 || error != 0) {
+		return false;
+	}
+	const int flags = fcntl(connection, F_GETFL);
+	return flags >= 0 && fcntl(connection, F_SETFL, flags & ~O_NONBLOCK) >= 0;
+}
+
+Deadline NoDeadline() {
+	return Deadline::max();
+}
+
+bool IsInternalError(std::string_view response) {
+	return !response.empty() && static_cast<ResponseCode>(response.front()) == ResponseCode::INTERNAL_ERROR;
+}
+
+std::vector<Document> GetDocuments(ByteReader& reader) {
+	// id, relevance и rating
+	std::vector<Document> result(reader.GetCount(sizeof(int32_t) + sizeof(double) + sizeof(int32_t)));
+	for (Document& document : result) {
+		document.id = reader.GetI32();
+		document.relevance = reader.GetDouble();
+		document.rating = reader.GetI32();
+	}
+	return result;
+}
+
+}
+
+SearchLeaf::SearchLeaf(const SearchServer& search_server) : search_server_(search_server) {
+}
+
+SearchLeaf::~SearchLeaf() {
+	Stop();
+	std::lock_guard guard(connections_mutex_);
+	for (auto& connection : connections_) {
+		connection.join();
+	}
+}
+
+void SearchLeaf::Serve(const std::string& address) {
+	sockaddr_storage storage;
+	socklen_t length;
+	const int family = ParseAddress(address, storage, length);
+	const int listener = socket(family, SOCK_STREAM, 0);
+	if (listener < 0) {
+		throw std::runtime_error("Cannot create socket: "s + std::strerror(errno));
+	}
+	if (family == AF_UNIX) {
+		unlink(reinterpret_cast<sockaddr_un&>(storage).sun_path);
+	} else {
+		const int enable = 1;
+		setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+	}
+	if (bind(listener, reinterpret_cast<sockaddr*>(&storage), length) < 0 || listen(listener, SOMAXCONN) < 0) {
+		const std::string error = std::strerror(errno);
+		close(listener);
+		throw std::runtime_error("Cannot listen on "s + address + ": "s + error);
+	}
+	while (!stopping_) {
+		pollfd descriptor{listener, POLLIN, 0};
+		if (poll(&descriptor, 1, 100) <= 0) {
+			continue;
+		}
+		const int connection = accept(listener, nullptr, nullptr);
+		if (connection < 0) {
+			continue;
+		}
+		if (family == AF_INET) {
+			const int enable = 1;
+			setsockopt(connection, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+		}
+		std::lock_guard guard(connections_mutex_);
+		connections_.emplace_back([this, connection] {
+			ServeConnection(connection);
+		});
+	}
+	close(listener);
+	if (family == AF_UNIX) {
+		unlink(reinterpret_cast<sockaddr_un&>(storage).sun_path);
+	}
+}
+
+void SearchLeaf::Stop() {
+	stopping_ = true;
+}
+
+void SearchLeaf::ServeConnection(int connection) {
+	std::string request;
+	while (!stopping_) {
+		if (!WaitFor(connection, POLLIN, std::chrono::steady_clock::now() + std::chrono::milliseconds(100))) {
+			pollfd descriptor{connection, POLLIN, 0};
+			if (poll(&descriptor, 1, 0) < 0 || (descriptor.revents & (POLLERR | POLLHUP))) {
+				break;
+			}
+			continue;
+		}
+		if (!ReceiveFrame(connection, request, NoDeadline())) {
+			break;
+		}
+		std::string response;
+		try {
+			response = HandleRequest(request);
+		} catch (const std::exception& e) {
+			// кадр запроса прочитан целиком, поэтому соединение можно сохранить
+			ByteWriter writer;
+			writer.PutU8(static_cast<uint8_t>(ResponseCode::INTERNAL_ERROR));
+			writer.PutString(e.what());
+			response = std::move(writer.GetBuffer());
+		}
+		if (!SendFrame(connection, response, NoDeadline())) {
+			break;
+		}
+	}
+	close(connection);
+}
+
+std::string SearchLeaf::HandleRequest(std::string_view request) const {
+	ByteReader reader(request);
+	ByteWriter writer;
+	switch (static_cast<RequestType>(reader.GetU8())) {
+	case RequestType::STATISTICS:
+		for (uint32_t i = reader.GetU32(); i > 0; --i) {
+			const std::string_view raw_query = reader.GetString();
+			try {
+				const auto statistics = search_server_.GetTermStatistics(raw_query);
+				writer.PutU8(static_cast<uint8_t>(ResponseCode::OK));
+				PutStatistics(writer, statistics);
+			} catch (const std::invalid_argument& e) {
+				writer.PutU8(static_cast<uint8_t>(ResponseCode::INVALID_QUERY));
+				writer.PutString(e.what());
+			}
+		}
+		break;
+	case RequestType::SEARCH: {
+		const auto status = GetStatus(reader);
+		const auto ranker = GetRanker(reader);
+		for (uint32_t i = reader.GetU32(); i > 0; --i) {
+			const std::string_view raw_query = reader.GetString();
+			const auto statistics = GetStatistics(reader);
+			try {
+				const auto documents = VisitRanker(ranker, [&](auto ranker_type) {
+					return VisitStatusPredicate(status, [&](auto document_predicate) {
+						return search_server_.FindTopDocuments<decltype(ranker_type)>(raw_query, statistics, document_predicate);
+					});
+				});
+				writer.PutU8(static_cast<uint8_t>(ResponseCode::OK));
+				writer.PutU32(documents.size());
+				for (const Document& document : documents) {
+					writer.PutI32(document.id);
+					writer.PutDouble(document.relevance);
+					writer.PutI32(document.rating);
+				}
+			} catch (const std::invalid_argument& e) {
+				writer.PutU8(static_cast<uint8_t>(ResponseCode::INVALID_QUERY));
+				writer.PutString(e.what());
+			}
+		}
+		break;
+	}
+	case RequestType::MATCH: {
+		const std::string_view raw_query = reader.GetString();
+		const int document_id = reader.GetI32();
+		try {
+			const auto [words, status] = search_server_.MatchDocument(raw_query, document_id);
+			writer.PutU8(static_cast<uint8_t>(ResponseCode::OK));
+			writer.PutU8(static_cast<uint8_t>(status));
+			writer.PutU32(words.size());
+			for (const std::string_view word : words) {
+				writer.PutString(word);
+			}
+		} catch (const std::invalid_argument& e) {
+			writer.PutU8(static_cast<uint8_t>(ResponseCode::INVALID_QUERY));
+			writer.PutString(e.what());
+		} catch (const std::out_of_range&) {
+			writer.PutU8(static_cast<uint8_t>(ResponseCode::NOT_FOUND));
+		}
+		break;
+	}
+	default:
+		throw std::runtime_error("Unknown request type"s);
+	}
+	return std::move(writer.GetBuffer());
+}
+
+SearchCoordinator::SearchCoordinator(const std::vector<std::string>& leaf_addresses)
+: SearchCoordinator(leaf_addresses, Options()) {
+}
+
+SearchCoordinator::SearchCoordinator(const std::vector<std::string>& leaf_addresses, const Options& options)
+: options_(options) {
+	if (leaf_addresses.empty()) {
+		throw std::invalid_argument("Coordinator needs at least one leaf"s);
+	}
+	for (const std::string& address : leaf_addresses) {
+		sockaddr_storage storage;
+		socklen_t length;
+		ParseAddress(address, storage, length);
+		leaves_.push_back({address});
+	}
+}
+
+SearchCoordinator::~SearchCoordinator() {
+	for (Leaf& leaf : leaves_) {
+		if (leaf.connection >= 0) {
+			close(leaf.connection);
+		}
+	}
+}
+
+std::vector<std::vector<Document>> SearchCoordinator::FindTopDocuments(const std::vector<std::string>& raw_queries, DocumentStatus status,
+	RankerType ranker) {
+	failed_leaf_count_ = 0;
+	// лист отвечает на пустой пакет пустым кадром, который нельзя отличить от отказа
+	if (raw_queries.empty()) {
+		return {};
+	}
+	ByteWriter statistics_request;
+	statistics_request.PutU8(static_cast<uint8_t>(RequestType::STATISTICS));
+	statistics_request.PutU32(raw_queries.size());
+	for (const std::string& raw_query : raw_queries) {
+		statistics_request.PutString(raw_query);
+	}
+	const auto statistics_responses = Broadcast(statistics_request.GetBuffer(), std::vector<bool>(leaves_.size(), true));
+
+	std::vector<SearchServer::TermStatistics> statistics(raw_queries.size());
+	std::vector<bool> answered(leaves_.size());
+	for (size_t leaf = 0; leaf < leaves_.size(); ++leaf) {
+		if (statistics_responses[leaf].empty()) {
+			continue;
+		}
+		if (IsInternalError(statistics_responses[leaf])) {
+			++failed_leaf_count_;
+			continue;
+		}
+		answered[leaf] = true;
+		ByteReader reader(statistics_responses[leaf]);
+		for (auto& query_statistics : statistics) {
+			if (static_cast<ResponseCode>(reader.GetU8()) != ResponseCode::OK) {
+				throw std::invalid_argument(std::string(reader.GetString()));
+			}
+			query_statistics.Merge(GetStatistics(reader));
+		}
+	}
+
+	ByteWriter search_request;
+	search_request.PutU8(static_cast<uint8_t>(RequestType::SEARCH));
+	search_request.PutU8(static_cast<uint8_t>(status));
+	search_request.PutU8(static_cast<uint8_t>(ranker));
+	search_request.PutU32(raw_queries.size());
+	for (size_t i = 0; i < raw_queries.size(); ++i) {
+		search_request.PutString(raw_queries[i]);
+		PutStatistics(search_request, statistics[i]);
+	}
+	const auto search_responses = Broadcast(search_request.GetBuffer(), answered);
+
+	std::vector<std::vector<std::vector<Document>>> leaf_results(raw_queries.size());
+	for (const std::string& response : search_responses) {
+		if (response.empty()) {
+			continue;
+		}
+		if (IsInternalError(response)) {
+			++failed_leaf_count_;
+			continue;
+		}
+		ByteReader reader(response);
+		for (auto& query_results : leaf_results) {
+			if (static_cast<ResponseCode>(reader.GetU8()) != ResponseCode::OK) {
+				throw std::invalid_argument(std::string(reader.GetString()));
+			}
+			query_results.push_back(GetDocuments(reader));
+		}
+	}
+	std::vector<std::vector<Document>> result;
+	result.reserve(raw_queries.size());
+	for (const auto& query_results : leaf_results) {
+		result.push_back(MergeTopDocuments(query_results, MAX_RESULT_DOCUMENT_COUNT));
+	}
+	return result;
+}
+
+SearchCoordinator::MatchedWords SearchCoordinator::MatchDocument(const std::string_view raw_query, int document_id) {
+	failed_leaf_count_ = 0;
+	ByteWriter request;
+	request.PutU8(static_cast<uint8_t>(RequestType::MATCH));
+	request.PutString(raw_query);
+	request.PutI32(document_id);
+	for (const std::string& response : Broadcast(request.GetBuffer(), std::vector<bool>(leaves_.size(), true))) {
+		if (response.empty()) {
+			continue;
+		}
+		ByteReader reader(response);
+		switch (static_cast<ResponseCode>(reader.GetU8())) {
+		case ResponseCode::OK: {
+			const auto status = GetStatus(reader);
+			std::vector<std::string> words(reader.GetCount(sizeof(uint32_t)));
+			for (std::string& word : words) {
+				word = reader.GetString();
+			}
+			return {words, status};
+		}
+		case ResponseCode::INVALID_QUERY:
+			throw std::invalid_argument(std::string(reader.GetString()));
+		case ResponseCode::NOT_FOUND:
+			break;
+		case ResponseCode::INTERNAL_ERROR:
+			++failed_leaf_count_;
+			break;
+		}
+	}
+	throw std::out_of_range("Document "s + std::to_string(document_id) + " is not found"s);
+}
+
+size_t SearchCoordinator::GetLeafCount() const {
+	return leaves_.size();
+}
+
+size_t SearchCoordinator::GetFailedLeafCount() const {
+	return failed_leaf_count_;
+}
+
+std::vector<std::string> SearchCoordinator::Broadcast(const std::string& request, const std::vector<bool>& enabled) {
+	const Deadline deadline = std::chrono::steady_clock::now() + options_.leaf_timeout;
+	std::string frame = request;
+	// подключения ко всем листам идут одновременно и вместе укладываются в leaf_timeout,
+	// поэтому недоступный лист не задерживает остальные
+	std::vector<bool> connecting(leaves_.size());
+	for (size_t i = 0; i < leaves_.size(); ++i) {
+		if (enabled[i] && leaves_[i].connection < 0) {
+			leaves_[i].connection = StartConnect(leaves_[i].address);
+			connecting[i] = true;
+		}
+	}
+	std::vector<bool> sent(leaves_.size());
+	for (size_t i = 0; i < leaves_.size(); ++i) {
+		Leaf& leaf = leaves_[i];
+		if (!enabled[i]) {
+			continue;
+		}
+		if (connecting[i] && leaf.connection >= 0 && !FinishConnect(leaf.connection, deadline)) {
+			close(leaf.connection);
+			leaf.connection = -1;
+		}
+		sent[i] = leaf.connection >= 0 && SendFrame(leaf.connection, frame, deadline);
+	}
+	// ответы читаются после рассылки всем листам, поэтому листы работают параллельно
+	std::vector<std::string> responses(leaves_.size());
+	for (size_t i = 0; i < leaves_.size(); ++i) {
+		if (!enabled[i]) {
+			continue;
+		}
+		if (!sent[i] || !ReceiveFrame(leaves_[i].connection, responses[i], deadline)) {
+			// опоздавший ответ сбил бы поток кадров, поэтому соединение закрывается
+			if (leaves_[i].connection >= 0) {
+				close(leaves_[i].connection);
+				leaves_[i].connection = -1;
+			}
+			responses[i].clear();
+			++failed_leaf_count_;
+		}
+	}
+	return responses;
+}
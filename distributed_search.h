@@ -0,0 +1,89 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <tuple>
+#include <vector>
+#include "search_server.h"
+
+// Поиск по нескольким процессам. Каждый лист (SearchLeaf) владеет своей частью документов
+// и отвечает по бинарному протоколу; координатор (SearchCoordinator) рассылает запросы,
+// собирает частоты слов и длины документов для общего ранжирования и сливает локальные топы.
+// Адрес: "unix:/path/to/socket" или "tcp:127.0.0.1:port".
+
+class SearchLeaf {
+public:
+	explicit SearchLeaf(const SearchServer& search_server);
+	SearchLeaf(const SearchLeaf&) = delete;
+	SearchLeaf& operator=(const SearchLeaf&) = delete;
+	~SearchLeaf();
+
+	// блокирует вызывающий поток до Stop(); каждое соединение обслуживается отдельным потоком
+	void Serve(const std::string& address);
+	void Stop();
+
+private:
+	void ServeConnection(int connection);
+	std::string HandleRequest(std::string_view request) const;
+
+	const SearchServer& search_server_;
+	std::atomic<bool> stopping_ = false;
+	std::mutex connections_mutex_;
+	std::vector<std::thread> connections_;
+};
+
+class SearchCoordinator {
+public:
+	using MatchedWords = std::tuple<std::vector<std::string>, DocumentStatus>;
+
+	struct Options {
+		// лист, не ответивший за это время, исключается из ответа, соединение с ним переоткрывается
+		std::chrono::milliseconds leaf_timeout{1000};
+	};
+
+	explicit SearchCoordinator(const std::vector<std::string>& leaf_addresses);
+	SearchCoordinator(const std::vector<std::string>& leaf_addresses, const Options& options);
+	SearchCoordinator(const SearchCoordinator&) = delete;
+	SearchCoordinator& operator=(const SearchCoordinator&) = delete;
+	~SearchCoordinator();
+
+	// Ranker — функция ранжирования из ranker.h, листы получают её номер в запросе
+	template <typename Ranker = TfIdf>
+	std::vector<Document> FindTopDocuments(const std::string_view raw_query, DocumentStatus status = DocumentStatus::ACTUAL);
+	// все запросы пакета уходят каждому листу одним сообщением
+	template <typename Ranker = TfIdf>
+	std::vector<std::vector<Document>> FindTopDocuments(const std::vector<std::string>& raw_queries, DocumentStatus status = DocumentStatus::ACTUAL);
+	MatchedWords MatchDocument(const std::string_view raw_query, int document_id);
+
+	size_t GetLeafCount() const;
+	// число листов, не ответивших вовремя или ответивших ошибкой на последний запрос
+	size_t GetFailedLeafCount() const;
+
+private:
+	struct Leaf {
+		std::string address;
+		int connection = -1;
+	};
+
+	std::vector<std::vector<Document>> FindTopDocuments(const std::vector<std::string>& raw_queries, DocumentStatus status, RankerType ranker);
+	// отправляет запрос всем листам и возвращает ответы; пустая строка — лист не ответил
+	std::vector<std::string> Broadcast(const std::string& request, const std::vector<bool>& enabled);
+
+	std::vector<Leaf> leaves_;
+	Options options_;
+	size_t failed_leaf_count_ = 0;
+};
+
+template <typename Ranker>
+std::vector<Document> SearchCoordinator::FindTopDocuments(const std::string_view raw_query, DocumentStatus status) {
+	return FindTopDocuments(std::vector<std::string>{std::string(raw_query)}, status, Ranker::type).front();
+}
+
+template <typename Ranker>
+std::vector<std::vector<Document>> SearchCoordinator::FindTopDocuments(const std::vector<std::string>& raw_queries, DocumentStatus status) {
+	return FindTopDocuments(raw_queries, status, Ranker::type);
+}
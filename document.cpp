@@ -1,5 +1,8 @@
 #include "document.h"
 
+#include <algorithm>
+#include <cmath>
+
 using namespace std::string_literals;
 
 Document::Document(int id, double relevance, int rating)
@@ -8,6 +11,40 @@ Document::Document(int id, double relevance, int rating)
 , rating(rating) {
 }
 
+bool DocumentRelevanceGreater::operator()(const Document& lhs, const Document& rhs) const {
+	if (std::abs(lhs.relevance - rhs.relevance) < RELEVANCE_EPSILON) {
+		return lhs.rating > rhs.rating;
+	}
+	return lhs.relevance > rhs.relevance;
+}
+
+std::vector<Document> MergeTopDocuments(const std::vector<std::vector<Document>>& sorted_results, size_t count) {
+	// в вершине кучи — самый релевантный из текущих первых элементов списков
+	using Position = std::pair<size_t, size_t>;
+	const auto less_relevant = [&sorted_results](const Position& lhs, const Position& rhs) {
+		return DocumentRelevanceGreater()(sorted_results[rhs.first][rhs.second], sorted_results[lhs.first][lhs.second]);
+	};
+	std::vector<Position> heap;
+	for (size_t i = 0; i < sorted_results.size(); ++i) {
+		if (!sorted_results[i].empty()) {
+			heap.push_back({i, 0});
+		}
+	}
+	std::make_heap(heap.begin(), heap.end(), less_relevant);
+	std::vector<Document> result;
+	while (!heap.empty() && result.size() < count) {
+		std::pop_heap(heap.begin(), heap.end(), less_relevant);
+		auto& [list, position] = heap.back();
+		result.push_back(sorted_results[list][position]);
+		if (++position < sorted_results[list].size()) {
+			std::push_heap(heap.begin(), heap.end(), less_relevant);
+		} else {
+			heap.pop_back();
+		}
+	}
+	return result;
+}
+
 void PrintDocument(const Document& document) {
 	std::cout << "{ "s
 	<< "document_id = "s << document.id << ", "s
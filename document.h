@@ -10,6 +10,9 @@ enum class DocumentStatus {
 	REMOVED,
 };
 
+// релевантности, отличающиеся меньше чем на это, DocumentRelevanceGreater считает равными
+const double RELEVANCE_EPSILON = 1e-6;
+
 struct Document {
 	Document() = default;
 	Document(int id, double relevance, int rating);
@@ -18,6 +21,14 @@ struct Document {
 	int rating = 0;
 };
 
+// Порядок выдачи: по убыванию релевантности, при равной релевантности — по убыванию рейтинга
+struct DocumentRelevanceGreater {
+	bool operator()(const Document& lhs, const Document& rhs) const;
+};
+
+// слияние нескольких выдач, упорядоченных DocumentRelevanceGreater, в одну из не более чем count документов
+std::vector<Document> MergeTopDocuments(const std::vector<std::vector<Document>>& sorted_results, size_t count);
+
 void PrintDocument(const Document& document);
 void PrintMatchDocumentResult(int document_id, const std::vector<std::string_view> words, DocumentStatus status);
 std::ostream& operator<<(std::ostream& out, const Document& document);
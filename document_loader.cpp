@@ -0,0 +1,299 @@
+#include "document_loader.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <charconv>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <fcntl.h>
+#include <mutex>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+
+namespace {
+
+// очередь между стадиями: Push ждёт места, Pop — элемента; после Close Push отказывает,
+// а Pop дочитывает оставшееся
+template <typename T>
+class BoundedQueue {
+public:
+	explicit BoundedQueue(size_t capacity) : capacity_(std::max<size_t>(capacity, 1)) {
+	}
+
+	bool Push(T value) {
+		std::unique_lock lock(mutex_);
+		has_space_.wait(lock, [this] {
+			return closed_ || items_.size() < capacity_;
+		});
+		if (closed_) {
+			return false;
+		}
+		items_.push_back(std::move(value));
+		has_items_.notify_one();
+		return true;
+	}
+
+	bool Pop(T& value) {
+		std::unique_lock lock(mutex_);
+		has_items_.wait(lock, [this] {
+			return closed_ || !items_.empty();
+		});
+		if (items_.empty()) {
+			return false;
+		}
+		value = std::move(items_.front());
+		items_.pop_front();
+		has_space_.notify_one();
+		return true;
+	}
+
+	void Close() {
+		std::lock_guard guard(mutex_);
+		closed_ = true;
+		has_items_.notify_all();
+		has_space_.notify_all();
+	}
+
+private:
+	std::mutex mutex_;
+	std::condition_variable has_items_;
+	std::condition_variable has_space_;
+	std::deque<T> items_;
+	const size_t capacity_;
+	bool closed_ = false;
+};
+
+struct PendingDocument {
+	int id = 0;
+	DocumentStatus status = DocumentStatus::ACTUAL;
+	std::vector<int> ratings;
+	std::string_view text;
+	SearchServer::TokenizedDocument tokens;
+};
+
+using DocumentBatch = std::vector<PendingDocument>;
+
+int ParseInt(std::string_view text, size_t line_number) {
+	int result = 0;
+	const auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), result);
+	if (text.empty() || error != std::errc() || end != text.data() + text.size()) {
+		throw std::invalid_argument("Invalid number "s + std::string(text) + " in line "s + std::to_string(line_number));
+	}
+	return result;
+}
+
+DocumentStatus ParseStatus(std::string_view text, size_t line_number) {
+	static const std::pair<std::string_view, DocumentStatus> names[] = {
+		{"ACTUAL", DocumentStatus::ACTUAL},
+		{"IRRELEVANT", DocumentStatus::IRRELEVANT},
+		{"BANNED", DocumentStatus::BANNED},
+		{"REMOVED", DocumentStatus::REMOVED},
+	};
+	for (const auto& [name, status] : names) {
+		if (text == name) {
+			return status;
+		}
+	}
+	const int status = ParseInt(text, line_number);
+	if (status < 0 || status > static_cast<int>(DocumentStatus::REMOVED)) {
+		throw std::invalid_argument("Invalid status "s + std::string(text) + " in line "s + std::to_string(line_number));
+	}
+	return static_cast<DocumentStatus>(status);
+}
+
+std::string_view NextField(std::string_view& line, size_t line_number) {
+	const size_t tab = line.find('\t');
+	if (tab == line.npos) {
+		throw std::invalid_argument("Too few fields in line "s + std::to_string(line_number));
+	}
+	const std::string_view field = line.substr(0, tab);
+	line.remove_prefix(tab + 1);
+	return field;
+}
+
+PendingDocument ParseLine(std::string_view line, size_t line_number, const IngestOptions& options) {
+	PendingDocument document;
+	if (options.format == DocumentFormat::PLAIN) {
+		document.id = options.first_document_id + static_cast<int>(line_number);
+		document.text = line;
+		return document;
+	}
+	document.id = ParseInt(NextField(line, line_number), line_number);
+	document.status = ParseStatus(NextField(line, line_number), line_number);
+	for (const std::string_view rating : SplitIntoWords(NextField(line, line_number))) {
+		if (!rating.empty()) {
+			document.ratings.push_back(ParseInt(rating, line_number));
+		}
+	}
+	document.text = line;
+	return document;
+}
+
+}
+
+double IngestStats::GetDocumentsPerSecond() const {
+	const double seconds = std::chrono::duration<double>(duration).count();
+	return seconds > 0 ? documents / seconds : 0.0;
+}
+
+double IngestStats::GetMegabytesPerSecond() const {
+	const double seconds = std::chrono::duration<double>(duration).count();
+	return seconds > 0 ? bytes / 1e6 / seconds : 0.0;
+}
+
+MappedFile::MappedFile(const std::string& path) {
+	const int file = open(path.c_str(), O_RDONLY);
+	if (file < 0) {
+		throw std::runtime_error("Cannot open "s + path + ": "s + std::strerror(errno));
+	}
+	struct stat status;
+	if (fstat(file, &status) < 0) {
+		const std::string error = std::strerror(errno);
+		close(file);
+		throw std::runtime_error("Cannot stat "s + path + ": "s + error);
+	}
+	size_ = static_cast<size_t>(status.st_size);
+	if (size_ > 0) {
+		data_ = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, file, 0);
+		if (data_ == MAP_FAILED) {
+			const std::string error = std::strerror(errno);
+			data_ = nullptr;
+			close(file);
+			throw std::runtime_error("Cannot map "s + path + ": "s + error);
+		}
+		// файл читается один раз от начала до конца
+		madvise(data_, size_, MADV_SEQUENTIAL);
+	}
+	close(file);
+}
+
+MappedFile::~MappedFile() {
+	if (data_ != nullptr) {
+		munmap(data_, size_);
+	}
+}
+
+std::string_view MappedFile::GetData() const {
+	return {static_cast<const char*>(data_), size_};
+}
+
+IngestStats IngestDocuments(SearchServer& search_server, std::string_view text, const IngestOptions& options) {
+	const auto start_time = std::chrono::steady_clock::now();
+	BoundedQueue<DocumentBatch> parsed(options.queue_capacity);
+	BoundedQueue<DocumentBatch> tokenized(options.queue_capacity);
+	std::mutex error_mutex;
+	std::exception_ptr error;
+	const auto Fail = [&](std::exception_ptr current) {
+		{
+			std::lock_guard guard(error_mutex);
+			if (!error) {
+				error = current;
+			}
+		}
+		parsed.Close();
+		tokenized.Close();
+	};
+	const size_t batch_size = std::max<size_t>(options.batch_size, 1);
+
+	std::thread parser([&] {
+		try {
+			DocumentBatch batch;
+			std::string_view rest = text;
+			for (size_t line_number = 0; !rest.empty(); ++line_number) {
+				const size_t end = std::min(rest.find('\n'), rest.size());
+				std::string_view line = rest.substr(0, end);
+				rest.remove_prefix(std::min(end + 1, rest.size()));
+				if (!line.empty() && line.back() == '\r') {
+					line.remove_suffix(1);
+				}
+				if (line.empty()) {
+					continue;
+				}
+				batch.push_back(ParseLine(line, line_number, options));
+				if (batch.size() == batch_size) {
+					if (!parsed.Push(std::move(batch))) {
+						return;
+					}
+					batch = DocumentBatch();
+					batch.reserve(batch_size);
+				}
+			}
+			if (!batch.empty()) {
+				parsed.Push(std::move(batch));
+			}
+			parsed.Close();
+		} catch (...) {
+			Fail(std::current_exception());
+		}
+	});
+
+	const bool with_positions = search_server.GetIndexOptions().positions;
+	// последний завершившийся токенизатор закрывает очередь к индексу
+	const size_t tokenizer_count = std::max<size_t>(options.tokenizer_count, 1);
+	std::atomic<size_t> active_tokenizers = tokenizer_count;
+	std::vector<std::thread> tokenizers;
+	for (size_t i = 0; i < tokenizer_count; ++i) {
+		tokenizers.emplace_back([&] {
+			try {
+				DocumentBatch batch;
+				std::vector<uint32_t> positions;
+				while (parsed.Pop(batch)) {
+					// слова группируются здесь, чтобы стадия индекса обращалась к словарю один раз на слово
+					for (PendingDocument& document : batch) {
+						const auto words = search_server.TokenizeDocument(document.text, with_positions ? &positions : nullptr);
+						document.tokens = SearchServer::GroupDocumentWords(words, positions);
+					}
+					if (!tokenized.Push(std::move(batch))) {
+						break;
+					}
+				}
+			} catch (...) {
+				Fail(std::current_exception());
+			}
+			if (--active_tokenizers == 0) {
+				tokenized.Close();
+			}
+		});
+	}
+
+	IngestStats stats;
+	stats.bytes = text.size();
+	try {
+		DocumentBatch batch;
+		while (tokenized.Pop(batch)) {
+			for (const PendingDocument& document : batch) {
+				search_server.AddTokenizedDocument(document.id, document.tokens, document.status, document.ratings);
+				++stats.documents;
+			}
+		}
+	} catch (...) {
+		Fail(std::current_exception());
+	}
+
+	parser.join();
+	for (std::thread& tokenizer : tokenizers) {
+		tokenizer.join();
+	}
+	if (error) {
+		std::rethrow_exception(error);
+	}
+	stats.duration = std::chrono::steady_clock::now() - start_time;
+	return stats;
+}
+
+IngestStats IngestDocumentsFromFile(SearchServer& search_server, const std::string& path, const IngestOptions& options) {
+	const MappedFile file(path);
+	return IngestDocuments(search_server, file.GetData(), options);
+}
+
+std::ostream& operator<<(std::ostream& out, const IngestStats& stats) {
+	return out << stats.documents << " documents, "s << stats.bytes << " bytes in "s
+		<< std::chrono::duration_cast<std::chrono::milliseconds>(stats.duration).count() << " ms ("s
+		<< stats.GetDocumentsPerSecond() << " docs/sec, "s << stats.GetMegabytesPerSecond() << " MB/sec)"s;
+}
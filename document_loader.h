@@ -0,0 +1,61 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include "search_server.h"
+
+// Загрузка документов из файла конвейером: разбор строк, разбиение на слова с группировкой
+// по слову (SearchServer::GroupDocumentWords) и добавление в индекс идут в разных потоках
+// и связаны очередями ограниченного размера. Стадия индекса — единственная последовательная,
+// поэтому вся работа, не меняющая индекс, вынесена из неё.
+// Текст документов не копируется — слова остаются string_view на буфер файла до добавления в индекс.
+
+enum class DocumentFormat {
+	// документ на строку, id — номер строки начиная с IngestOptions::first_document_id, статус ACTUAL
+	PLAIN,
+	// id<TAB>статус<TAB>рейтинги через пробел<TAB>текст; статус — имя (ACTUAL, BANNED, ...) или число
+	TSV,
+};
+
+struct IngestOptions {
+	DocumentFormat format = DocumentFormat::PLAIN;
+	int first_document_id = 0;
+	// документов в одном элементе очереди
+	size_t batch_size = 256;
+	// пакетов в каждой очереди между стадиями
+	size_t queue_capacity = 8;
+	size_t tokenizer_count = 1;
+};
+
+struct IngestStats {
+	size_t documents = 0;
+	size_t bytes = 0;
+	std::chrono::nanoseconds duration{0};
+
+	double GetDocumentsPerSecond() const;
+	double GetMegabytesPerSecond() const;
+};
+
+// файл, отображённый в память только для чтения
+class MappedFile {
+public:
+	explicit MappedFile(const std::string& path);
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+	~MappedFile();
+
+	std::string_view GetData() const;
+
+private:
+	void* data_ = nullptr;
+	size_t size_ = 0;
+};
+
+// text должен жить до возврата из функции; первая ошибка любой стадии останавливает конвейер
+// и пробрасывается, уже добавленные документы остаются в индексе
+IngestStats IngestDocuments(SearchServer& search_server, std::string_view text, const IngestOptions& options = IngestOptions());
+IngestStats IngestDocumentsFromFile(SearchServer& search_server, const std::string& path, const IngestOptions& options = IngestOptions());
+
+std::ostream& operator<<(std::ostream& out, const IngestStats& stats);
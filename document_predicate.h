@@ -0,0 +1,72 @@
+#pragma once
+
+#include <stdexcept>
+#include <string>
+#include "document.h"
+
+// Предикаты, которые сервер распознаёт на этапе компиляции. Они зависят только от статуса
+// и рейтинга документа, поэтому проверяются один раз для каждого найденного документа,
+// а не на каждом вхождении слова; AcceptAll не проверяется вовсе.
+// Произвольные функции (int id, DocumentStatus, int rating) -> bool по-прежнему проверяются на каждом вхождении.
+
+struct AcceptAll {
+	bool operator()(int, DocumentStatus, int) const {
+		return true;
+	}
+};
+
+template <DocumentStatus Status>
+struct ByStatus {
+	bool operator()(int, DocumentStatus status, int) const {
+		return status == Status;
+	}
+};
+
+template <int MinRating>
+struct RatingAtLeast {
+	bool operator()(int, DocumentStatus, int rating) const {
+		return rating >= MinRating;
+	}
+};
+
+template <typename DocumentPredicate>
+struct DocumentPredicateTraits {
+	// результат не зависит от id, проверку можно отложить до сбора кандидатов
+	static constexpr bool is_document_filter = false;
+	static constexpr bool accepts_all = false;
+};
+
+template <>
+struct DocumentPredicateTraits<AcceptAll> {
+	static constexpr bool is_document_filter = true;
+	static constexpr bool accepts_all = true;
+};
+
+template <DocumentStatus Status>
+struct DocumentPredicateTraits<ByStatus<Status>> {
+	static constexpr bool is_document_filter = true;
+	static constexpr bool accepts_all = false;
+};
+
+template <int MinRating>
+struct DocumentPredicateTraits<RatingAtLeast<MinRating>> {
+	static constexpr bool is_document_filter = true;
+	static constexpr bool accepts_all = false;
+};
+
+// вызывает function(ByStatus<status>()) — статус, известный только во время выполнения,
+// превращается в тип. Значение вне DocumentStatus — std::invalid_argument
+template <typename Function>
+decltype(auto) VisitStatusPredicate(DocumentStatus status, Function function) {
+	switch (status) {
+	case DocumentStatus::IRRELEVANT:
+		return function(ByStatus<DocumentStatus::IRRELEVANT>());
+	case DocumentStatus::BANNED:
+		return function(ByStatus<DocumentStatus::BANNED>());
+	case DocumentStatus::REMOVED:
+		return function(ByStatus<DocumentStatus::REMOVED>());
+	case DocumentStatus::ACTUAL:
+		return function(ByStatus<DocumentStatus::ACTUAL>());
+	}
+	throw std::invalid_argument("Unknown document status " + std::to_string(static_cast<int>(status)));
+}
@@ -0,0 +1,298 @@
+#include "durable_search_server.h"
+#include "document_loader.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <execution>
+#include <fcntl.h>
+#include <fstream>
+#include <unistd.h>
+
+namespace {
+
+const uint32_t DURABLE_SNAPSHOT_MAGIC = 0x53534453;
+// записей журнала, разбираемых на слова за один параллельный проход
+const size_t REPLAY_CHUNK_SIZE = 4096;
+
+enum class LogRecordType : uint8_t {
+	// слова документа, сгруппированные SearchServer::GroupDocumentWords: восстановление
+	// не разбирает текст заново и сразу добавляет их в индекс
+	ADD_DOCUMENT = 1,
+	REMOVE_DOCUMENT = 2,
+	ADD_STOP_WORD = 3,
+	REMOVE_STOP_WORD = 4,
+};
+
+template <typename T>
+void AppendValue(std::string& payload, T value) {
+	payload.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+template <typename T>
+T ReadValue(std::string_view& payload) {
+	T value;
+	if (payload.size() < sizeof(value)) {
+		throw std::runtime_error("Log record is corrupted"s);
+	}
+	std::memcpy(&value, payload.data(), sizeof(value));
+	payload.remove_prefix(sizeof(value));
+	return value;
+}
+
+// число элементов, каждый из которых занимает в записи не меньше min_element_size байт:
+// испорченная запись не должна приводить к огромным выделениям памяти
+uint32_t ReadCount(std::string_view& payload, size_t min_element_size) {
+	const uint32_t count = ReadValue<uint32_t>(payload);
+	if (static_cast<uint64_t>(count) * min_element_size > payload.size()) {
+		throw std::runtime_error("Log record is corrupted"s);
+	}
+	return count;
+}
+
+DocumentStatus ReadStatus(std::string_view& payload) {
+	const auto status = ReadValue<uint8_t>(payload);
+	if (status > static_cast<uint8_t>(DocumentStatus::REMOVED)) {
+		throw std::runtime_error("Log record is corrupted"s);
+	}
+	return static_cast<DocumentStatus>(status);
+}
+
+struct LoggedDocument {
+	int id = 0;
+	DocumentStatus status = DocumentStatus::ACTUAL;
+	std::vector<int> ratings;
+	// string_view на записи журнала
+	SearchServer::TokenizedDocument tokens;
+};
+
+std::string EncodeDocument(int document_id, DocumentStatus status, const std::vector<int>& ratings, const SearchServer::TokenizedDocument& document) {
+	size_t size = sizeof(int32_t) * (ratings.size() + 5) + 1 + sizeof(uint32_t) * document.positions.size();
+	for (const auto& [word, _] : document.terms) {
+		size += sizeof(uint32_t) * 2 + word.size();
+	}
+	std::string payload;
+	payload.reserve(size);
+	AppendValue<int32_t>(payload, document_id);
+	AppendValue<uint8_t>(payload, static_cast<uint8_t>(status));
+	AppendValue<uint32_t>(payload, ratings.size());
+	for (const int rating : ratings) {
+		AppendValue<int32_t>(payload, rating);
+	}
+	AppendValue<uint32_t>(payload, document.length);
+	AppendValue<uint32_t>(payload, document.terms.size());
+	for (const auto& [word, count] : document.terms) {
+		AppendValue<uint32_t>(payload, word.size());
+		payload.append(word);
+		AppendValue<uint32_t>(payload, count);
+	}
+	AppendValue<uint32_t>(payload, document.positions.size());
+	payload.append(reinterpret_cast<const char*>(document.positions.data()), sizeof(uint32_t) * document.positions.size());
+	return payload;
+}
+
+LoggedDocument DecodeDocument(const WalRecord& record) {
+	std::string_view payload = record.payload;
+	LoggedDocument document;
+	document.id = ReadValue<int32_t>(payload);
+	document.status = ReadStatus(payload);
+	document.ratings.resize(ReadCount(payload, sizeof(int32_t)));
+	for (int& rating : document.ratings) {
+		rating = ReadValue<int32_t>(payload);
+	}
+	document.tokens.length = ReadValue<uint32_t>(payload);
+	document.tokens.terms.resize(ReadCount(payload, 2 * sizeof(uint32_t)));
+	for (auto& [word, count] : document.tokens.terms) {
+		const uint32_t size = ReadCount(payload, 1);
+		word = payload.substr(0, size);
+		payload.remove_prefix(size);
+		count = ReadValue<uint32_t>(payload);
+	}
+	document.tokens.positions.resize(ReadCount(payload, sizeof(uint32_t)));
+	for (uint32_t& position : document.tokens.positions) {
+		position = ReadValue<uint32_t>(payload);
+	}
+	return document;
+}
+
+void SyncPath(const std::string& path, int flags) {
+	const int file = open(path.c_str(), flags);
+	if (file < 0 || fsync(file) < 0) {
+		const std::string error = std::strerror(errno);
+		if (file >= 0) {
+			close(file);
+		}
+		throw std::runtime_error("Cannot sync "s + path + ": "s + error);
+	}
+	close(file);
+}
+
+}
+
+DurableSearchServer::DurableSearchServer(const std::string& snapshot_path, const std::string& log_path, SearchServer initial_server,
+	const WalOptions& options)
+: snapshot_path_(snapshot_path)
+, log_path_(log_path)
+, search_server_(LoadInitialServer(snapshot_path, std::move(initial_server), snapshot_sequence_)) {
+	const auto start_time = std::chrono::steady_clock::now();
+	recovery_stats_.snapshot_loaded = access(snapshot_path.c_str(), F_OK) == 0;
+	size_t valid_size = 0;
+	uint64_t last_sequence = snapshot_sequence_;
+	if (access(log_path.c_str(), F_OK) == 0) {
+		const MappedFile file(log_path);
+		const std::vector<WalRecord> records = WriteAheadLog::ParseRecords(file.GetData(), &valid_size);
+		recovery_stats_.discarded_bytes = file.GetData().size() - valid_size;
+		if (!records.empty()) {
+			last_sequence = std::max(last_sequence, records.back().sequence);
+		}
+		ReplayLog(records);
+	}
+	log_ = std::make_unique<WriteAheadLog>(log_path, valid_size, last_sequence + 1, options);
+	recovery_stats_.duration = std::chrono::steady_clock::now() - start_time;
+}
+
+SearchServer DurableSearchServer::LoadInitialServer(const std::string& snapshot_path, SearchServer initial_server, uint64_t& snapshot_sequence) {
+	std::ifstream in(snapshot_path, std::ios::binary);
+	if (!in) {
+		return initial_server;
+	}
+	uint32_t magic = 0;
+	in.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+	in.read(reinterpret_cast<char*>(&snapshot_sequence), sizeof(snapshot_sequence));
+	if (!in || magic != DURABLE_SNAPSHOT_MAGIC) {
+		throw std::runtime_error("Unsupported snapshot format in "s + snapshot_path);
+	}
+	return SearchServer::LoadSnapshot(in);
+}
+
+void DurableSearchServer::ReplayLog(const std::vector<WalRecord>& records) {
+	std::vector<const WalRecord*> document_records;
+	std::vector<LoggedDocument> documents;
+	size_t begin = 0;
+	while (begin < records.size() && records[begin].sequence <= snapshot_sequence_) {
+		++begin;
+	}
+	recovery_stats_.skipped_records = begin;
+	while (begin < records.size()) {
+		// изменения стоп-слов применяются между пачками в порядке журнала: RemoveStopWord
+		// вычищает слово только из документов, добавленных до него
+		size_t end = begin;
+		document_records.clear();
+		for (; end < records.size() && end - begin < REPLAY_CHUNK_SIZE; ++end) {
+			const auto type = static_cast<LogRecordType>(records[end].type);
+			if (type == LogRecordType::ADD_STOP_WORD || type == LogRecordType::REMOVE_STOP_WORD) {
+				break;
+			}
+			if (type == LogRecordType::ADD_DOCUMENT) {
+				document_records.push_back(&records[end]);
+			} else if (type != LogRecordType::REMOVE_DOCUMENT) {
+				throw std::runtime_error("Unknown log record type "s + std::to_string(records[end].type));
+			}
+		}
+		documents.resize(document_records.size());
+		std::transform(std::execution::par, document_records.begin(), document_records.end(), documents.begin(), [](const WalRecord* record) {
+			return DecodeDocument(*record);
+		});
+		auto document = documents.begin();
+		for (size_t i = begin; i < end; ++i) {
+			std::string_view payload = records[i].payload;
+			if (static_cast<LogRecordType>(records[i].type) == LogRecordType::REMOVE_DOCUMENT) {
+				search_server_.RemoveDocument(ReadValue<int32_t>(payload));
+			} else {
+				search_server_.AddTokenizedDocument(document->id, document->tokens, document->status, document->ratings);
+				++document;
+			}
+		}
+		if (end < records.size() && end - begin < REPLAY_CHUNK_SIZE) {
+			const WalRecord& record = records[end];
+			if (static_cast<LogRecordType>(record.type) == LogRecordType::ADD_STOP_WORD) {
+				search_server_.AddStopWord(record.payload);
+			} else {
+				search_server_.RemoveStopWord(record.payload);
+			}
+			++end;
+		}
+		recovery_stats_.replayed_records += end - begin;
+		begin = end;
+	}
+}
+
+void DurableSearchServer::AddDocument(int document_id, const std::string_view document, DocumentStatus status, const std::vector<int>& ratings) {
+	// разбиение зависит от стоп-слов, поэтому идёт под той же блокировкой, что и их изменение
+	std::unique_lock lock(mutex_);
+	std::vector<uint32_t> positions;
+	const auto words = search_server_.TokenizeDocument(document, search_server_.GetIndexOptions().positions ? &positions : nullptr);
+	const auto tokens = SearchServer::GroupDocumentWords(words, positions);
+	search_server_.AddTokenizedDocument(document_id, tokens, status, ratings);
+	Log(static_cast<uint8_t>(LogRecordType::ADD_DOCUMENT), EncodeDocument(document_id, status, ratings, tokens), lock);
+}
+
+void DurableSearchServer::RemoveDocument(int document_id) {
+	std::string payload;
+	AppendValue<int32_t>(payload, document_id);
+	std::unique_lock lock(mutex_);
+	search_server_.RemoveDocument(document_id);
+	Log(static_cast<uint8_t>(LogRecordType::REMOVE_DOCUMENT), payload, lock);
+}
+
+void DurableSearchServer::AddStopWord(const std::string_view word) {
+	std::unique_lock lock(mutex_);
+	search_server_.AddStopWord(word);
+	Log(static_cast<uint8_t>(LogRecordType::ADD_STOP_WORD), std::string(word), lock);
+}
+
+void DurableSearchServer::RemoveStopWord(const std::string_view word) {
+	std::unique_lock lock(mutex_);
+	search_server_.RemoveStopWord(word);
+	Log(static_cast<uint8_t>(LogRecordType::REMOVE_STOP_WORD), std::string(word), lock);
+}
+
+void DurableSearchServer::Log(uint8_t type, const std::string& payload, std::unique_lock<std::mutex>& lock) {
+	const uint64_t sequence = log_->Append(type, payload);
+	lock.unlock();
+	// ожидание вне блокировки: записи других потоков попадают в ту же fsync
+	if (log_->GetOptions().wait_for_sync) {
+		log_->WaitForSync(sequence);
+	}
+}
+
+void DurableSearchServer::Sync() {
+	log_->Sync();
+}
+
+void DurableSearchServer::Checkpoint() {
+	std::lock_guard guard(mutex_);
+	log_->Sync();
+	const uint64_t sequence = log_->GetLastSequence();
+	// снимок пишется рядом и подменяет старый атомарно; журнал очищается только после этого,
+	// а записи, уже вошедшие в снимок, при восстановлении пропускаются
+	const std::string temporary_path = snapshot_path_ + ".tmp"s;
+	{
+		std::ofstream out(temporary_path, std::ios::binary | std::ios::trunc);
+		if (!out) {
+			throw std::runtime_error("Cannot create snapshot "s + temporary_path);
+		}
+		out.write(reinterpret_cast<const char*>(&DURABLE_SNAPSHOT_MAGIC), sizeof(DURABLE_SNAPSHOT_MAGIC));
+		out.write(reinterpret_cast<const char*>(&sequence), sizeof(sequence));
+		search_server_.SaveSnapshot(out);
+		out.close();
+		if (!out) {
+			throw std::runtime_error("Cannot write snapshot "s + temporary_path);
+		}
+	}
+	SyncPath(temporary_path, O_RDONLY);
+	if (std::rename(temporary_path.c_str(), snapshot_path_.c_str()) < 0) {
+		throw std::runtime_error("Cannot replace snapshot "s + snapshot_path_ + ": "s + std::strerror(errno));
+	}
+	const size_t slash = snapshot_path_.rfind('/');
+	SyncPath(slash == std::string::npos ? "."s : snapshot_path_.substr(0, slash + 1), O_RDONLY | O_DIRECTORY);
+	log_->Reset();
+}
+
+const SearchServer& DurableSearchServer::GetSearchServer() const {
+	return search_server_;
+}
+
+const DurableSearchServer::RecoveryStats& DurableSearchServer::GetRecoveryStats() const {
+	return recovery_stats_;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "search_server.h"
+#include "write_ahead_log.h"
+
+// Сервер, переживающий перезапуск: каждое изменение индекса записывается в журнал (WriteAheadLog),
+// а при запуске индекс восстанавливается из последнего снимка и записей журнала после него.
+// Изменения можно вызывать из нескольких потоков, но не одновременно с запросами к GetSearchServer.
+class DurableSearchServer {
+public:
+	struct RecoveryStats {
+		bool snapshot_loaded = false;
+		size_t replayed_records = 0;
+		// записи, уже вошедшие в снимок
+		size_t skipped_records = 0;
+		// недописанный при сбое хвост журнала
+		size_t discarded_bytes = 0;
+		std::chrono::nanoseconds duration{0};
+	};
+
+	// initial_server — пустой сервер со стоп-словами и IndexOptions на случай, если снимка ещё нет
+	DurableSearchServer(const std::string& snapshot_path, const std::string& log_path, SearchServer initial_server,
+		const WalOptions& options = WalOptions());
+	DurableSearchServer(const DurableSearchServer&) = delete;
+	DurableSearchServer& operator=(const DurableSearchServer&) = delete;
+
+	// изменение сначала применяется к индексу — ошибочное не попадает в журнал. Ошибка записи
+	// журнала (std::runtime_error) значит, что изменение применено, но может не пережить перезапуск
+	void AddDocument(int document_id, const std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
+	void RemoveDocument(int document_id);
+	void AddStopWord(const std::string_view word);
+	void RemoveStopWord(const std::string_view word);
+
+	// ждёт fsync всех изменений
+	void Sync();
+	// сохраняет снимок и очищает журнал; сбой на любом шаге не теряет изменений
+	void Checkpoint();
+
+	const SearchServer& GetSearchServer() const;
+	const RecoveryStats& GetRecoveryStats() const;
+
+private:
+	static SearchServer LoadInitialServer(const std::string& snapshot_path, SearchServer initial_server, uint64_t& snapshot_sequence);
+	// применяет записи с номером больше snapshot_sequence_; записи документов разбираются
+	// параллельно между записями, меняющими стоп-слова, в индекс они добавляются по порядку
+	void ReplayLog(const std::vector<WalRecord>& records);
+	void Log(uint8_t type, const std::string& payload, std::unique_lock<std::mutex>& lock);
+
+	const std::string snapshot_path_;
+	const std::string log_path_;
+	uint64_t snapshot_sequence_ = 0;
+	SearchServer search_server_;
+	RecoveryStats recovery_stats_;
+	std::mutex mutex_;
+	std::unique_ptr<WriteAheadLog> log_;
+};
@@ -0,0 +1,44 @@
+#include "latency_stats.h"
+
+#include <algorithm>
+#include <cmath>
+
+void LatencyRecorder::Reserve(size_t count) {
+	latencies_.reserve(count);
+}
+
+void LatencyRecorder::Add(std::chrono::nanoseconds latency) {
+	latencies_.push_back(latency.count());
+	total_ += latency.count();
+	sorted_ = false;
+}
+
+void LatencyRecorder::Merge(const LatencyRecorder& other) {
+	latencies_.insert(latencies_.end(), other.latencies_.begin(), other.latencies_.end());
+	total_ += other.total_;
+	sorted_ = false;
+}
+
+size_t LatencyRecorder::GetCount() const {
+	return latencies_.size();
+}
+
+std::chrono::nanoseconds LatencyRecorder::GetTotal() const {
+	return std::chrono::nanoseconds(total_);
+}
+
+std::chrono::nanoseconds LatencyRecorder::GetMean() const {
+	return std::chrono::nanoseconds(latencies_.empty() ? 0 : total_ / static_cast<int64_t>(latencies_.size()));
+}
+
+std::chrono::nanoseconds LatencyRecorder::GetPercentile(double fraction) const {
+	if (latencies_.empty()) {
+		return std::chrono::nanoseconds(0);
+	}
+	if (!sorted_) {
+		std::sort(latencies_.begin(), latencies_.end());
+		sorted_ = true;
+	}
+	const double rank = std::clamp(fraction, 0.0, 1.0) * (latencies_.size() - 1);
+	return std::chrono::nanoseconds(latencies_[static_cast<size_t>(std::ceil(rank))]);
+}
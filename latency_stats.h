@@ -0,0 +1,24 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+// Накопитель латентностей отдельных операций для вычисления перцентилей
+class LatencyRecorder {
+public:
+	void Reserve(size_t count);
+	void Add(std::chrono::nanoseconds latency);
+	void Merge(const LatencyRecorder& other);
+
+	size_t GetCount() const;
+	std::chrono::nanoseconds GetTotal() const;
+	std::chrono::nanoseconds GetMean() const;
+	// fraction из [0, 1]: 0.5 — медиана, 0.999 — p999
+	std::chrono::nanoseconds GetPercentile(double fraction) const;
+
+private:
+	mutable std::vector<int64_t> latencies_;
+	mutable bool sorted_ = true;
+	int64_t total_ = 0;
+};
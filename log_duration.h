@@ -1,20 +1,40 @@
 #pragma once
 
 #include <chrono>
+#include <functional>
 #include <iostream>
+#include <string>
+#include <string_view>
 
 #define PROFILE_CONCAT_INTERNAL(X, Y) X##Y
 #define PROFILE_CONCAT(X, Y) PROFILE_CONCAT_INTERNAL(X, Y)
 #define UNIQUE_VAR_NAME_PROFILE PROFILE_CONCAT(profileGuard, __LINE__)
 #define LOG_DURATION(x) LogDuration UNIQUE_VAR_NAME_PROFILE(x)
+#define LOG_DURATION_STREAM(x, out) LogDuration UNIQUE_VAR_NAME_PROFILE(x, out, LogDuration::Unit::NANOSECONDS)
 
 class LogDuration {
 public:
 	// заменим имя типа std::chrono::steady_clock
 	// с помощью using для удобства
 	using Clock = std::chrono::steady_clock;
+	// приёмник результата вместо потока, например гистограмма метрик
+	using Sink = std::function<void(std::string_view id, std::chrono::nanoseconds duration)>;
 
-	LogDuration(const std::string_view& id) : id_(id) {
+	enum class Unit {
+		NANOSECONDS,
+		MICROSECONDS,
+		MILLISECONDS,
+	};
+
+	LogDuration(const std::string_view& id, std::ostream& out = std::cerr, Unit unit = Unit::MILLISECONDS)
+	: id_(id)
+	, out_(&out)
+	, unit_(unit) {
+	}
+
+	LogDuration(const std::string_view& id, Sink sink)
+	: id_(id)
+	, sink_(std::move(sink)) {
 	}
 
 	~LogDuration() {
@@ -22,11 +42,30 @@ public:
 		using namespace std::literals;
 
 		const auto end_time = Clock::now();
-		const auto dur = end_time - start_time_;
-		std::cerr << id_ << ": "s << duration_cast<milliseconds>(dur).count() << " ms"s << std::endl;
+		const auto dur = duration_cast<nanoseconds>(end_time - start_time_);
+		if (sink_) {
+			sink_(id_, dur);
+			return;
+		}
+		*out_ << id_ << ": "s;
+		switch (unit_) {
+		case Unit::NANOSECONDS:
+			*out_ << dur.count() << " ns"s;
+			break;
+		case Unit::MICROSECONDS:
+			*out_ << duration_cast<microseconds>(dur).count() << " us"s;
+			break;
+		case Unit::MILLISECONDS:
+			*out_ << duration_cast<milliseconds>(dur).count() << " ms"s;
+			break;
+		}
+		*out_ << std::endl;
 	}
 
 private:
 	const std::string id_;
+	std::ostream* out_ = nullptr;
+	Unit unit_ = Unit::MILLISECONDS;
+	Sink sink_;
 	const Clock::time_point start_time_ = Clock::now();
 };
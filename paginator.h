@@ -2,6 +2,8 @@
 
 #include <utility>
 #include <algorithm>
+#include <iterator>
+#include <type_traits>
 #include <vector>
 
 template <typename Iterator>
@@ -9,8 +11,7 @@ class IteratorRange {
 public:
 	IteratorRange(Iterator begin, Iterator end)
 	: first_(begin)
-	, last_(end)
-	, size_(distance(first_, last_)) {
+	, last_(end) {
 	}
 
 	Iterator begin() const {
@@ -22,12 +23,11 @@ public:
 	}
 
 	size_t size() const {
-		return size_;
+		return std::distance(first_, last_);
 	}
 
 private:
 	Iterator first_, last_;
-	size_t size_;
 };
 
 template <typename Iterator>
@@ -38,37 +38,136 @@ std::ostream& operator<<(std::ostream& out, const IteratorRange<Iterator>& range
 	return out;
 }
 
+// Страницы не материализуются: границы следующей страницы вычисляются при инкременте итератора
 template <typename Iterator>
 class Paginator {
 public:
-	Paginator(Iterator begin, Iterator end, size_t page_size) {
-		for (size_t left = distance(begin, end); left > 0;) {
-			const size_t current_page_size = std::min(page_size, left);
-			const Iterator current_page_end = next(begin, current_page_size);
-			pages_.push_back({begin, current_page_end});
-
-			left -= current_page_size;
-			begin = current_page_end;
+	class PageIterator {
+	public:
+		using iterator_category = std::forward_iterator_tag;
+		using value_type = IteratorRange<Iterator>;
+		using difference_type = std::ptrdiff_t;
+		using pointer = void;
+		using reference = value_type;
+
+		PageIterator(Iterator begin, Iterator end, size_t page_size)
+		: page_begin_(begin)
+		, page_end_(Advance(begin, end, page_size))
+		, end_(end)
+		, page_size_(page_size) {
+		}
+
+		IteratorRange<Iterator> operator*() const {
+			return {page_begin_, page_end_};
+		}
+
+		PageIterator& operator++() {
+			page_begin_ = page_end_;
+			page_end_ = Advance(page_begin_, end_, page_size_);
+			return *this;
+		}
+
+		PageIterator operator++(int) {
+			PageIterator result = *this;
+			++*this;
+			return result;
+		}
+
+		bool operator==(const PageIterator& other) const {
+			return page_begin_ == other.page_begin_;
 		}
+
+		bool operator!=(const PageIterator& other) const {
+			return !(*this == other);
+		}
+
+	private:
+		static Iterator Advance(Iterator it, Iterator end, size_t count) {
+			using Category = typename std::iterator_traits<Iterator>::iterator_category;
+			if constexpr (std::is_base_of_v<std::random_access_iterator_tag, Category>) {
+				return it + std::min<std::ptrdiff_t>(count, end - it);
+			} else {
+				for (; count > 0 && it != end; --count) {
+					++it;
+				}
+				return it;
+			}
+		}
+
+		Iterator page_begin_, page_end_, end_;
+		size_t page_size_;
+	};
+
+	Paginator(Iterator begin, Iterator end, size_t page_size)
+	: begin_(begin)
+	, end_(end)
+	, page_size_(std::max<size_t>(page_size, 1)) {
 	}
 
-	auto begin() const {
-		return pages_.begin();
+	PageIterator begin() const {
+		return {begin_, end_, page_size_};
 	}
 
-	auto end() const {
-		return pages_.end();
+	PageIterator end() const {
+		return {end_, end_, page_size_};
 	}
 
 	size_t size() const {
-		return pages_.size();
+		return (std::distance(begin_, end_) + page_size_ - 1) / page_size_;
 	}
 
 private:
-	std::vector<IteratorRange<Iterator>> pages_;
+	Iterator begin_, end_;
+	size_t page_size_;
 };
 
 template <typename Container>
 auto Paginate(const Container& c, size_t page_size) {
   return Paginator<decltype(begin(c))>(begin(c), end(c), page_size);
-}
\ No newline at end of file
+}
+
+// Курсор по уже вычисленному набору: очередная страница упорядочивается только когда её запросили,
+// поэтому продолжение выдачи не требует повторного подсчёта релевантности
+template <typename Value, typename Compare>
+class PageCursor {
+public:
+	using ConstIterator = typename std::vector<Value>::const_iterator;
+
+	PageCursor(std::vector<Value> values, size_t page_size, Compare compare = Compare())
+	: values_(std::move(values))
+	, page_size_(std::max<size_t>(page_size, 1))
+	, compare_(compare) {
+	}
+
+	bool HasNextPage() const {
+		return position_ < values_.size();
+	}
+
+	IteratorRange<ConstIterator> NextPage() {
+		const size_t page_end = std::min(position_ + page_size_, values_.size());
+		if (page_end > sorted_) {
+			const auto sorted_end = values_.begin() + page_end;
+			std::nth_element(values_.begin() + sorted_, sorted_end - 1, values_.end(), compare_);
+			std::sort(values_.begin() + sorted_, sorted_end, compare_);
+			sorted_ = page_end;
+		}
+		IteratorRange<ConstIterator> page(values_.cbegin() + position_, values_.cbegin() + page_end);
+		position_ = page_end;
+		return page;
+	}
+
+	size_t GetPosition() const {
+		return position_;
+	}
+
+	size_t size() const {
+		return values_.size();
+	}
+
+private:
+	std::vector<Value> values_;
+	size_t page_size_;
+	size_t position_ = 0;
+	size_t sorted_ = 0;
+	Compare compare_;
+};
@@ -0,0 +1,250 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+// оценки сверху для ранжирования по одному слову (см. ranker.h): максимумы по всем вхождениям,
+// когда-либо добавленным в список; удаление документов их не уменьшает, они остаются верными
+struct PostingBounds {
+	double max_term_freq = 0.0;
+	uint32_t max_term_count = 0;
+	uint32_t min_document_length = std::numeric_limits<uint32_t>::max();
+};
+
+// Список вхождений одного слова, упорядоченный по document_id.
+// Непрерывный массив вместо std::map: 16 байт на вхождение вместо узла дерева.
+class PostingList {
+public:
+	// длина документа занимает выравнивание между id и double, поэтому вхождение
+	// по-прежнему 16 байт, а Bm25 не ищет длину в дереве документов
+	struct Posting {
+		int document_id;
+		// число слов документа без стоп-слов
+		uint32_t document_length;
+		// доля этого слова среди них
+		double term_freq;
+	};
+	using ConstIterator = std::vector<Posting>::const_iterator;
+
+	void Add(int document_id, double term_freq, uint32_t document_length) {
+		if (postings_.empty() || postings_.back().document_id < document_id) {
+			postings_.push_back({document_id, document_length, term_freq});
+			UpdateBounds(term_freq, document_length);
+			return;
+		}
+		auto it = LowerBound(document_id);
+		if (it != postings_.end() && it->document_id == document_id) {
+			it->term_freq += term_freq;
+		} else {
+			it = postings_.insert(it, {document_id, document_length, term_freq});
+		}
+		UpdateBounds(it->term_freq, document_length);
+	}
+
+	bool Erase(int document_id) {
+		const auto it = LowerBound(document_id);
+		if (it == postings_.end() || it->document_id != document_id) {
+			return false;
+		}
+		postings_.erase(it);
+		return true;
+	}
+
+	ConstIterator Find(int document_id) const {
+		const auto it = std::lower_bound(postings_.begin(), postings_.end(), document_id, IdLess());
+		return it != postings_.end() && it->document_id == document_id ? it : postings_.end();
+	}
+
+	size_t count(int document_id) const {
+		return Find(document_id) != postings_.end();
+	}
+
+	// первое вхождение не левее from с id не меньше document_id: шаги 1, 2, 4, ... вперёд,
+	// затем двоичный поиск в последнем шаге. При возрастающих document_id обход всего списка
+	// стоит O(k log(n / k)) для k запросов
+	ConstIterator Gallop(ConstIterator from, int document_id) const {
+		size_t step = 1;
+		auto low = from;
+		while (low != postings_.end() && low->document_id < document_id) {
+			const auto high = static_cast<size_t>(postings_.end() - low) > step ? low + step : postings_.end();
+			if (high == postings_.end() || high->document_id >= document_id) {
+				return std::lower_bound(low, high, document_id, IdLess());
+			}
+			low = high;
+			step *= 2;
+		}
+		return low;
+	}
+
+	ConstIterator begin() const {
+		return postings_.begin();
+	}
+
+	ConstIterator end() const {
+		return postings_.end();
+	}
+
+	size_t size() const {
+		return postings_.size();
+	}
+
+	bool empty() const {
+		return postings_.empty();
+	}
+
+	void ShrinkToFit() {
+		postings_.shrink_to_fit();
+	}
+
+	const PostingBounds& GetBounds() const {
+		return bounds_;
+	}
+
+	size_t GetMemoryUsage() const {
+		return postings_.capacity() * sizeof(Posting);
+	}
+
+private:
+	void UpdateBounds(double term_freq, uint32_t document_length) {
+		bounds_.max_term_freq = std::max(bounds_.max_term_freq, term_freq);
+		bounds_.max_term_count = std::max(bounds_.max_term_count, static_cast<uint32_t>(std::lround(term_freq * document_length)));
+		bounds_.min_document_length = std::min(bounds_.min_document_length, document_length);
+	}
+
+	struct IdLess {
+		bool operator()(const Posting& posting, int document_id) const {
+			return posting.document_id < document_id;
+		}
+	};
+
+	std::vector<Posting>::iterator LowerBound(int document_id) {
+		return std::lower_bound(postings_.begin(), postings_.end(), document_id, IdLess());
+	}
+
+	std::vector<Posting> postings_;
+	PostingBounds bounds_;
+};
+
+// Позиции одного слова в документах. Возрастающие позиции документа хранятся разностями
+// в varint в общем байтовом потоке, отдельно от PostingList: обычные запросы их не читают.
+class PositionList {
+public:
+	// positions должны возрастать
+	void Add(int document_id, const std::vector<uint32_t>& positions) {
+		Entry entry{document_id, static_cast<uint32_t>(data_.size()), 0};
+		uint32_t previous = 0;
+		for (const uint32_t position : positions) {
+			PutVarint(position - previous);
+			previous = position;
+		}
+		entry.size = static_cast<uint32_t>(data_.size()) - entry.offset;
+		if (entries_.empty() || entries_.back().document_id < document_id) {
+			entries_.push_back(entry);
+			return;
+		}
+		const auto it = LowerBound(document_id);
+		if (it != entries_.end() && it->document_id == document_id) {
+			garbage_bytes_ += it->size;
+			*it = entry;
+		} else {
+			entries_.insert(it, entry);
+		}
+	}
+
+	// байты удалённого документа остаются в потоке до ShrinkToFit
+	bool Erase(int document_id) {
+		const auto it = LowerBound(document_id);
+		if (it == entries_.end() || it->document_id != document_id) {
+			return false;
+		}
+		garbage_bytes_ += it->size;
+		entries_.erase(it);
+		return true;
+	}
+
+	bool Get(int document_id, std::vector<uint32_t>& positions) const {
+		positions.clear();
+		const auto it = std::lower_bound(entries_.begin(), entries_.end(), document_id, IdLess());
+		if (it == entries_.end() || it->document_id != document_id) {
+			return false;
+		}
+		uint32_t position = 0;
+		for (size_t i = it->offset, end = it->offset + it->size; i < end;) {
+			position += GetVarint(i);
+			positions.push_back(position);
+		}
+		return true;
+	}
+
+	size_t size() const {
+		return entries_.size();
+	}
+
+	bool empty() const {
+		return entries_.empty();
+	}
+
+	void ShrinkToFit() {
+		if (garbage_bytes_ > 0) {
+			std::vector<uint8_t> data;
+			data.reserve(data_.size() - garbage_bytes_);
+			for (Entry& entry : entries_) {
+				const uint32_t offset = static_cast<uint32_t>(data.size());
+				data.insert(data.end(), data_.begin() + entry.offset, data_.begin() + entry.offset + entry.size);
+				entry.offset = offset;
+			}
+			data_ = std::move(data);
+			garbage_bytes_ = 0;
+		}
+		entries_.shrink_to_fit();
+		data_.shrink_to_fit();
+	}
+
+	size_t GetMemoryUsage() const {
+		return entries_.capacity() * sizeof(Entry) + data_.capacity();
+	}
+
+private:
+	struct Entry {
+		int document_id;
+		uint32_t offset;
+		uint32_t size;
+	};
+
+	struct IdLess {
+		bool operator()(const Entry& entry, int document_id) const {
+			return entry.document_id < document_id;
+		}
+	};
+
+	std::vector<Entry>::iterator LowerBound(int document_id) {
+		return std::lower_bound(entries_.begin(), entries_.end(), document_id, IdLess());
+	}
+
+	void PutVarint(uint32_t value) {
+		while (value >= 0x80) {
+			data_.push_back(static_cast<uint8_t>(value | 0x80));
+			value >>= 7;
+		}
+		data_.push_back(static_cast<uint8_t>(value));
+	}
+
+	uint32_t GetVarint(size_t& index) const {
+		uint32_t value = 0;
+		for (int shift = 0;; shift += 7) {
+			const uint8_t byte = data_[index++];
+			value |= static_cast<uint32_t>(byte & 0x7f) << shift;
+			if ((byte & 0x80) == 0) {
+				return value;
+			}
+		}
+	}
+
+	std::vector<Entry> entries_;
+	std::vector<uint8_t> data_;
+	size_t garbage_bytes_ = 0;
+};
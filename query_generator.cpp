@@ -0,0 +1,96 @@
+#include "query_generator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <string_view>
+#include <unordered_set>
+
+namespace {
+
+const std::mt19937::result_type RANK_SEED = 5489;
+
+}
+
+std::string GenerateWord(std::mt19937& generator, int max_length) {
+	const int length = std::uniform_int_distribution(1, max_length)(generator);
+	std::string word;
+	word.reserve(length);
+	for (int i = 0; i < length; ++i) {
+		word.push_back(std::uniform_int_distribution('a', 'z')(generator));
+	}
+	return word;
+}
+
+std::vector<std::string> GenerateDictionary(std::mt19937& generator, int word_count, int max_length) {
+	std::vector<std::string> words;
+	words.reserve(word_count);
+	for (int i = 0; i < word_count; ++i) {
+		words.push_back(GenerateWord(generator, max_length));
+	}
+	words.erase(std::unique(words.begin(), words.end()), words.end());
+	return words;
+}
+
+WordSampler::WordSampler(const std::vector<std::string>& dictionary, double zipf_exponent)
+: dictionary_(dictionary) {
+	if (zipf_exponent == 0) {
+		return;
+	}
+	// ранг получает каждое слово один раз (в словаре возможны повторы); порядок рангов
+	// перемешан с фиксированным зерном, чтобы самым частым не оказалось dictionary[0],
+	// которое тесты используют как стоп-слово
+	std::unordered_set<std::string_view> seen_words;
+	for (size_t i = 0; i < dictionary.size(); ++i) {
+		if (seen_words.insert(dictionary[i]).second) {
+			ranked_words_.push_back(i);
+		}
+	}
+	std::mt19937 rank_generator(RANK_SEED);
+	std::shuffle(ranked_words_.begin(), ranked_words_.end(), rank_generator);
+	cumulative_weights_.reserve(ranked_words_.size());
+	double total_weight = 0;
+	for (size_t rank = 0; rank < ranked_words_.size(); ++rank) {
+		total_weight += 1.0 / std::pow(rank + 1.0, zipf_exponent);
+		cumulative_weights_.push_back(total_weight);
+	}
+}
+
+const std::string& WordSampler::operator()(std::mt19937& generator) const {
+	if (cumulative_weights_.empty()) {
+		return dictionary_[std::uniform_int_distribution<size_t>(0, dictionary_.size() - 1)(generator)];
+	}
+	const double point = std::uniform_real_distribution<>(0, cumulative_weights_.back())(generator);
+	const auto it = std::upper_bound(cumulative_weights_.begin(), cumulative_weights_.end(), point);
+	return dictionary_[ranked_words_[std::min<size_t>(it - cumulative_weights_.begin(), ranked_words_.size() - 1)]];
+}
+
+std::string GenerateQuery(std::mt19937& generator, const WordSampler& sampler, int word_count, double minus_prob) {
+	std::string query;
+	for (int i = 0; i < word_count; ++i) {
+		if (!query.empty()) {
+			query.push_back(' ');
+		}
+		if (std::uniform_real_distribution<>(0, 1)(generator) < minus_prob) {
+			query.push_back('-');
+		}
+		query += sampler(generator);
+	}
+	return query;
+}
+
+std::string GenerateQuery(std::mt19937& generator, const std::vector<std::string>& dictionary, int word_count, double minus_prob) {
+	return GenerateQuery(generator, WordSampler(dictionary), word_count, minus_prob);
+}
+
+std::vector<std::string> GenerateQueries(std::mt19937& generator, const WordSampler& sampler, int query_count, int max_word_count, double minus_prob) {
+	std::vector<std::string> queries;
+	queries.reserve(query_count);
+	for (int i = 0; i < query_count; ++i) {
+		queries.push_back(GenerateQuery(generator, sampler, max_word_count, minus_prob));
+	}
+	return queries;
+}
+
+std::vector<std::string> GenerateQueries(std::mt19937& generator, const std::vector<std::string>& dictionary, int query_count, int max_word_count) {
+	return GenerateQueries(generator, WordSampler(dictionary), query_count, max_word_count);
+}
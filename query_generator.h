@@ -0,0 +1,28 @@
+#pragma once
+
+#include <random>
+#include <string>
+#include <vector>
+
+std::string GenerateWord(std::mt19937& generator, int max_length);
+std::vector<std::string> GenerateDictionary(std::mt19937& generator, int word_count, int max_length);
+
+// Выбор слова из словаря: вероятность слова с рангом r пропорциональна 1 / (r + 1)^zipf_exponent,
+// при zipf_exponent == 0 распределение равномерное
+class WordSampler {
+public:
+	WordSampler(const std::vector<std::string>& dictionary, double zipf_exponent = 0);
+
+	const std::string& operator()(std::mt19937& generator) const;
+
+private:
+	const std::vector<std::string>& dictionary_;
+	// индексы слов словаря в порядке рангов
+	std::vector<size_t> ranked_words_;
+	std::vector<double> cumulative_weights_;
+};
+
+std::string GenerateQuery(std::mt19937& generator, const WordSampler& sampler, int word_count, double minus_prob = 0);
+std::string GenerateQuery(std::mt19937& generator, const std::vector<std::string>& dictionary, int word_count, double minus_prob = 0);
+std::vector<std::string> GenerateQueries(std::mt19937& generator, const WordSampler& sampler, int query_count, int max_word_count, double minus_prob = 0);
+std::vector<std::string> GenerateQueries(std::mt19937& generator, const std::vector<std::string>& dictionary, int query_count, int max_word_count);
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include "posting_list.h"
+
+// Функции ранжирования — параметр шаблона FindTopDocuments, поэтому вызов на каждом вхождении
+// встраивается без виртуальной диспетчеризации. Всё, что зависит только от слова и коллекции,
+// TermScorer вычисляет один раз на слово запроса; на вхождение остаётся несколько умножений
+// и одно деление без ветвлений. Релевантность документа — сумма вкладов слов запроса.
+
+// число документов и их средняя длина — по всему индексу или по всем шардам сразу
+struct RankingStatistics {
+	int document_count = 0;
+	double average_document_length = 0.0;
+
+	static RankingStatistics FromTotals(int document_count, uint64_t total_document_length) {
+		RankingStatistics result;
+		result.document_count = document_count;
+		result.average_document_length = document_count > 0 ? total_document_length * 1.0 / document_count : 0.0;
+		return result;
+	}
+};
+
+// номер функции ранжирования в запросах к листам, см. distributed_search.h
+enum class RankerType : uint8_t {
+	TF_IDF = 1,
+	BM25 = 2,
+};
+
+// term_freq * log(N / df), term_freq — доля слова среди слов документа
+struct TfIdf {
+	static constexpr RankerType type = RankerType::TF_IDF;
+
+	static double ComputeInverseDocumentFreq(int document_count, size_t document_freq) {
+		return std::log(document_count * 1.0 / document_freq);
+	}
+
+	class TermScorer {
+	public:
+		TermScorer(double inverse_document_freq, const RankingStatistics&) : inverse_document_freq_(inverse_document_freq) {
+		}
+
+		double operator()(double term_freq, uint32_t) const {
+			return term_freq * inverse_document_freq_;
+		}
+
+		// не меньше вклада слова в любой документ
+		double GetUpperBound(const PostingBounds& bounds) const {
+			return bounds.max_term_freq * inverse_document_freq_;
+		}
+
+	private:
+		double inverse_document_freq_;
+	};
+};
+
+// Okapi BM25: idf * tf * (k1 + 1) / (tf + k1 * (1 - b + b * длина / средняя длина)),
+// tf — число вхождений слова в документ
+struct Bm25 {
+	static constexpr RankerType type = RankerType::BM25;
+	static constexpr double k1 = 1.2;
+	static constexpr double b = 0.75;
+
+	static double ComputeInverseDocumentFreq(int document_count, size_t document_freq) {
+		return std::log(1.0 + (document_count - static_cast<double>(document_freq) + 0.5) / (document_freq + 0.5));
+	}
+
+	class TermScorer {
+	public:
+		TermScorer(double inverse_document_freq, const RankingStatistics& statistics)
+		: weight_(inverse_document_freq * (k1 + 1))
+		, length_base_(k1 * (1 - b))
+		, length_factor_(statistics.average_document_length > 0 ? k1 * b / statistics.average_document_length : 0.0) {
+		}
+
+		double operator()(double term_freq, uint32_t document_length) const {
+			const double term_count = term_freq * document_length;
+			return weight_ * term_count / (term_count + length_base_ + length_factor_ * document_length);
+		}
+
+		// вклад растёт с числом вхождений и убывает с длиной документа
+		double GetUpperBound(const PostingBounds& bounds) const {
+			const double term_count = bounds.max_term_count;
+			return weight_ * term_count / (term_count + length_base_ + length_factor_ * bounds.min_document_length);
+		}
+
+	private:
+		double weight_;
+		double length_base_;
+		double length_factor_;
+	};
+};
+
+// вызывает function(TfIdf()) или function(Bm25()); значение вне RankerType — std::invalid_argument
+template <typename Function>
+decltype(auto) VisitRanker(RankerType type, Function function) {
+	switch (type) {
+	case RankerType::TF_IDF:
+		return function(TfIdf());
+	case RankerType::BM25:
+		return function(Bm25());
+	}
+	throw std::invalid_argument("Unknown ranker " + std::to_string(static_cast<int>(type)));
+}
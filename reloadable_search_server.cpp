@@ -0,0 +1,88 @@
+#include "reloadable_search_server.h"
+
+#include <fstream>
+#include <thread>
+
+ReloadableSearchServer::Handle::Handle(Slot* slot) : slot_(slot) {
+}
+
+ReloadableSearchServer::Handle::Handle(Handle&& other) noexcept : slot_(other.slot_) {
+	other.slot_ = nullptr;
+}
+
+ReloadableSearchServer::Handle& ReloadableSearchServer::Handle::operator=(Handle&& other) noexcept {
+	if (this != &other) {
+		if (slot_ != nullptr) {
+			--slot_->readers;
+		}
+		slot_ = other.slot_;
+		other.slot_ = nullptr;
+	}
+	return *this;
+}
+
+ReloadableSearchServer::Handle::~Handle() {
+	if (slot_ != nullptr) {
+		--slot_->readers;
+	}
+}
+
+const SearchServer& ReloadableSearchServer::Handle::operator*() const {
+	return *slot_->search_server;
+}
+
+const SearchServer* ReloadableSearchServer::Handle::operator->() const {
+	return slot_->search_server.get();
+}
+
+ReloadableSearchServer::ReloadableSearchServer(SearchServer search_server) {
+	slots_[0].search_server = std::make_unique<SearchServer>(std::move(search_server));
+}
+
+ReloadableSearchServer::Handle ReloadableSearchServer::Acquire() const {
+	while (true) {
+		const size_t index = active_slot_.load();
+		Slot& slot = slots_[index];
+		++slot.readers;
+		// слот мог смениться между чтением номера и захватом: тогда отпускаем его и пробуем снова.
+		// Reload очищает слот, только увидев нулевой счётчик после переключения, поэтому
+		// подтверждённый здесь слот не будет очищен, пока мы его держим
+		if (active_slot_.load() == index) {
+			return Handle(&slot);
+		}
+		--slot.readers;
+	}
+}
+
+void ReloadableSearchServer::Reload(SearchServer search_server) {
+	std::lock_guard guard(reload_mutex_);
+	const size_t old_index = active_slot_.load();
+	Slot& new_slot = slots_[1 - old_index];
+	// в свободный слот могли ненадолго зайти читатели, прочитавшие устаревший номер
+	WaitForReaders(new_slot);
+	new_slot.search_server = std::make_unique<SearchServer>(std::move(search_server));
+	active_slot_.store(1 - old_index);
+	++generation_;
+
+	Slot& old_slot = slots_[old_index];
+	WaitForReaders(old_slot);
+	old_slot.search_server.reset();
+}
+
+void ReloadableSearchServer::ReloadFromSnapshot(const std::string& path) {
+	std::ifstream in(path, std::ios::binary);
+	if (!in) {
+		throw std::runtime_error("Cannot open snapshot "s + path);
+	}
+	Reload(SearchServer::LoadSnapshot(in));
+}
+
+size_t ReloadableSearchServer::GetGeneration() const {
+	return generation_.load();
+}
+
+void ReloadableSearchServer::WaitForReaders(const Slot& slot) const {
+	while (slot.readers.load() > 0) {
+		std::this_thread::yield();
+	}
+}
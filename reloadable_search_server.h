@@ -0,0 +1,61 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include "search_server.h"
+
+// Сервер с подменой индекса на лету. Два слота: читатели работают с активным, новый индекс
+// кладётся в свободный, после чего активный слот переключается. Запросы, начатые до подмены,
+// дорабатывают со старым индексом; у читателей нет блокировок — только счётчик слота.
+class ReloadableSearchServer {
+	struct Slot {
+		std::unique_ptr<SearchServer> search_server;
+		std::atomic<size_t> readers = 0;
+	};
+
+public:
+	// удерживает индекс, действовавший в момент Acquire, до своего разрушения
+	class Handle {
+	public:
+		Handle(const Handle&) = delete;
+		Handle& operator=(const Handle&) = delete;
+		Handle(Handle&& other) noexcept;
+		Handle& operator=(Handle&& other) noexcept;
+		~Handle();
+
+		const SearchServer& operator*() const;
+		const SearchServer* operator->() const;
+
+	private:
+		friend class ReloadableSearchServer;
+		explicit Handle(Slot* slot);
+
+		Slot* slot_;
+	};
+
+	explicit ReloadableSearchServer(SearchServer search_server);
+	ReloadableSearchServer(const ReloadableSearchServer&) = delete;
+	ReloadableSearchServer& operator=(const ReloadableSearchServer&) = delete;
+
+	Handle Acquire() const;
+
+	// возвращается, когда все запросы к старому индексу завершились и он удалён;
+	// одновременные Reload выполняются по очереди
+	void Reload(SearchServer search_server);
+	// индекс из файла SearchServer::SaveSnapshot
+	void ReloadFromSnapshot(const std::string& path);
+
+	// число выполненных подмен
+	size_t GetGeneration() const;
+
+private:
+	void WaitForReaders(const Slot& slot) const;
+
+	mutable std::array<Slot, 2> slots_;
+	std::atomic<size_t> active_slot_ = 0;
+	std::atomic<size_t> generation_ = 0;
+	std::mutex reload_mutex_;
+};
@@ -0,0 +1,259 @@
+#include "search_server.h"
+#include "process_queries.h"
+#include "document_loader.h"
+#include "latency_stats.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <execution>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+// Воспроизведение журнала запросов.
+// Журнал: запрос на строку, перед ним может стоять время отправки в миллисекундах и табуляция.
+// Открытая нагрузка (--load open) отправляет запросы по расписанию — по времени из журнала
+// (с ускорением --speed) или равномерно с частотой --qps — независимо от того, успевает ли сервер,
+// латентность считается от запланированного момента. Закрытая (--load closed) держит --clients
+// клиентов, каждый отправляет следующий запрос после ответа на предыдущий.
+
+namespace {
+
+enum class ReplayMode {
+    SEQ,
+    PAR,
+    BATCH,
+};
+
+struct ReplayConfig {
+    string documents_path;
+    DocumentFormat documents_format = DocumentFormat::PLAIN;
+    string stop_words;
+    string queries_path;
+    ReplayMode mode = ReplayMode::SEQ;
+    bool open_loop = false;
+    double qps = 0;
+    double speed = 1;
+    int clients = 1;
+    int batch_size = 100;
+};
+
+struct QueryLog {
+    vector<string> queries;
+    vector<chrono::nanoseconds> send_times;
+};
+
+ReplayConfig ParseArguments(int argc, char* argv[]) {
+    ReplayConfig config;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        const string_view key = argv[i];
+        const string value = argv[i + 1];
+        if (key == "--documents"sv) {
+            config.documents_path = value;
+        } else if (key == "--format"sv) {
+            if (value != "plain"s && value != "tsv"s) {
+                throw invalid_argument("Unknown document format "s + value);
+            }
+            config.documents_format = value == "tsv"s ? DocumentFormat::TSV : DocumentFormat::PLAIN;
+        } else if (key == "--stop-words"sv) {
+            config.stop_words = value;
+        } else if (key == "--queries"sv) {
+            config.queries_path = value;
+        } else if (key == "--mode"sv) {
+            if (value == "seq"s) {
+                config.mode = ReplayMode::SEQ;
+            } else if (value == "par"s) {
+                config.mode = ReplayMode::PAR;
+            } else if (value == "batch"s) {
+                config.mode = ReplayMode::BATCH;
+            } else {
+                throw invalid_argument("Unknown mode "s + value);
+            }
+        } else if (key == "--load"sv) {
+            if (value != "open"s && value != "closed"s) {
+                throw invalid_argument("Unknown load model "s + value);
+            }
+            config.open_loop = value == "open"s;
+        } else if (key == "--qps"sv) {
+            config.qps = stod(value);
+        } else if (key == "--speed"sv) {
+            config.speed = stod(value);
+        } else if (key == "--clients"sv) {
+            config.clients = max(1, stoi(value));
+        } else if (key == "--batch-size"sv) {
+            config.batch_size = max(1, stoi(value));
+        } else {
+            throw invalid_argument("Unknown option "s + string(key));
+        }
+    }
+    if (config.documents_path.empty() || config.queries_path.empty()) {
+        throw invalid_argument("Usage: search_replay --documents FILE --queries FILE [--format plain|tsv] [--stop-words WORDS]"
+                               " [--mode seq|par|batch] [--load open|closed] [--qps N] [--speed X] [--clients N] [--batch-size N]"s);
+    }
+    return config;
+}
+
+QueryLog ReadQueryLog(const string& path) {
+    const MappedFile file(path);
+    string_view text = file.GetData();
+    QueryLog log;
+    while (!text.empty()) {
+        const size_t end = min(text.find('\n'), text.size());
+        string_view line = text.substr(0, end);
+        text.remove_prefix(min(end + 1, text.size()));
+        if (!line.empty() && line.back() == '\r') {
+            line.remove_suffix(1);
+        }
+        if (line.empty()) {
+            continue;
+        }
+        chrono::nanoseconds send_time{0};
+        const size_t tab = line.find('\t');
+        if (tab != line.npos) {
+            send_time = chrono::duration_cast<chrono::nanoseconds>(chrono::duration<double, milli>(stod(string(line.substr(0, tab)))));
+            line.remove_prefix(tab + 1);
+        }
+        log.queries.emplace_back(line);
+        log.send_times.push_back(send_time);
+    }
+    // время отсчитывается от первого запроса журнала
+    if (!log.send_times.empty()) {
+        const auto first_time = *min_element(log.send_times.begin(), log.send_times.end());
+        for (auto& send_time : log.send_times) {
+            send_time -= first_time;
+        }
+    }
+    return log;
+}
+
+// запросы, отправляемые одной операцией: по одному или пакетами для ProcessQueries
+vector<vector<string>> MakeRequests(const ReplayConfig& config, const QueryLog& log) {
+    const size_t batch_size = config.mode == ReplayMode::BATCH ? config.batch_size : 1;
+    vector<vector<string>> requests((log.queries.size() + batch_size - 1) / batch_size);
+    for (size_t i = 0; i < log.queries.size(); ++i) {
+        requests[i / batch_size].push_back(log.queries[i]);
+    }
+    return requests;
+}
+
+// прогрев: каждый запрос выполняется один раз, отклонённые сервером запросы выбрасываются из журнала —
+// в пакетном режиме исключение из ProcessQueries завершило бы программу
+size_t RemoveRejectedQueries(const SearchServer& search_server, QueryLog& log) {
+    QueryLog accepted;
+    for (size_t i = 0; i < log.queries.size(); ++i) {
+        try {
+            search_server.FindTopDocuments(log.queries[i]);
+        } catch (const invalid_argument&) {
+            continue;
+        }
+        accepted.queries.push_back(move(log.queries[i]));
+        accepted.send_times.push_back(log.send_times[i]);
+    }
+    const size_t rejected = log.queries.size() - accepted.queries.size();
+    log = move(accepted);
+    return rejected;
+}
+
+void Execute(const SearchServer& search_server, ReplayMode mode, const vector<string>& request) {
+    switch (mode) {
+    case ReplayMode::SEQ:
+        search_server.FindTopDocuments(execution::seq, request.front());
+        break;
+    case ReplayMode::PAR:
+        search_server.FindTopDocuments(execution::par, request.front());
+        break;
+    case ReplayMode::BATCH:
+        ProcessQueries(search_server, request);
+        break;
+    }
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    using Clock = chrono::steady_clock;
+    try {
+        const ReplayConfig config = ParseArguments(argc, argv);
+
+        SearchServer search_server(config.stop_words);
+        IngestOptions ingest_options;
+        ingest_options.format = config.documents_format;
+        cout << "documents: "s << IngestDocumentsFromFile(search_server, config.documents_path, ingest_options) << endl;
+
+        QueryLog log = ReadQueryLog(config.queries_path);
+        const size_t rejected = RemoveRejectedQueries(search_server, log);
+        const vector<vector<string>> requests = MakeRequests(config, log);
+        const size_t batch_size = config.mode == ReplayMode::BATCH ? config.batch_size : 1;
+        vector<chrono::nanoseconds> send_times(requests.size());
+        for (size_t i = 0; i < requests.size(); ++i) {
+            send_times[i] = config.qps > 0
+                ? chrono::duration_cast<chrono::nanoseconds>(chrono::duration<double>(i * batch_size / config.qps))
+                : chrono::duration_cast<chrono::nanoseconds>(log.send_times[i * batch_size] / config.speed);
+        }
+
+        vector<chrono::nanoseconds> latencies(requests.size());
+        const auto start_time = Clock::now();
+        if (config.open_loop) {
+            ThreadPool::Options pool_options;
+            pool_options.thread_count = config.clients;
+            pool_options.max_queued_tasks = requests.size() + 1;
+            ThreadPool pool(pool_options);
+            atomic<size_t> completed = 0;
+            for (size_t i = 0; i < requests.size(); ++i) {
+                const auto scheduled_time = start_time + send_times[i];
+                this_thread::sleep_until(scheduled_time);
+                pool.Submit([&, i, scheduled_time] {
+                    Execute(search_server, config.mode, requests[i]);
+                    latencies[i] = Clock::now() - scheduled_time;
+                    ++completed;
+                });
+            }
+            while (completed.load() < requests.size()) {
+                this_thread::sleep_for(1ms);
+            }
+        } else {
+            atomic<size_t> next_request = 0;
+            vector<thread> clients;
+            for (int client = 0; client < config.clients; ++client) {
+                clients.emplace_back([&] {
+                    for (size_t i = next_request++; i < requests.size(); i = next_request++) {
+                        const auto request_start = Clock::now();
+                        Execute(search_server, config.mode, requests[i]);
+                        latencies[i] = Clock::now() - request_start;
+                    }
+                });
+            }
+            for (thread& client : clients) {
+                client.join();
+            }
+        }
+        const double seconds = chrono::duration<double>(Clock::now() - start_time).count();
+
+        LatencyRecorder recorder;
+        recorder.Reserve(latencies.size());
+        for (const auto latency : latencies) {
+            recorder.Add(latency);
+        }
+        const auto Microseconds = [](chrono::nanoseconds latency) {
+            return chrono::duration_cast<chrono::microseconds>(latency).count();
+        };
+        cout << fixed << setprecision(1)
+             << "queries: "s << log.queries.size() << " in "s << requests.size() << " requests, "s << rejected << " rejected"s << "\n"s
+             << "throughput: "s << (seconds > 0 ? log.queries.size() / seconds : 0.0) << " queries/sec over "s << seconds << " s\n"s
+             << "latency per request, us: mean "s << Microseconds(recorder.GetMean())
+             << ", p50 "s << Microseconds(recorder.GetPercentile(0.5))
+             << ", p90 "s << Microseconds(recorder.GetPercentile(0.9))
+             << ", p99 "s << Microseconds(recorder.GetPercentile(0.99))
+             << ", p999 "s << Microseconds(recorder.GetPercentile(0.999))
+             << ", max "s << Microseconds(recorder.GetPercentile(1.0)) << endl;
+    } catch (const exception& e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+}
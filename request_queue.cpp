@@ -4,8 +4,8 @@ RequestQueue::RequestQueue(const SearchServer& search_server) : server_(search_s
 }
 
 std::vector<Document> RequestQueue::AddFindRequest(const std::string& raw_query, DocumentStatus status) {
-	return AddFindRequest(raw_query, [status](int, DocumentStatus document_status, int) {
-		return document_status == status;
+	return VisitStatusPredicate(status, [&](auto document_predicate) {
+		return AddFindRequest(raw_query, document_predicate);
 	});
 }
 
@@ -14,5 +14,58 @@ std::vector<Document> RequestQueue::AddFindRequest(const std::string& raw_query)
 }
 
 int RequestQueue::GetNoResultRequests() const {
-	return empty_count;
-}
\ No newline at end of file
+	return std::max(empty_count_.load(std::memory_order_relaxed), 0);
+}
+
+int RequestQueue::GetRequestCount() const {
+	return std::max(request_count_.load(std::memory_order_relaxed), 0);
+}
+
+int64_t RequestQueue::GetHitCount() const {
+	return std::max(hit_count_.load(std::memory_order_relaxed), int64_t{0});
+}
+
+RequestQueue::LatencyHistogram RequestQueue::GetLatencyHistogram() const {
+	LatencyHistogram result;
+	for (int i = 0; i < LATENCY_BUCKET_COUNT; ++i) {
+		result[i] = std::max(latency_histogram_[i].load(std::memory_order_relaxed), 0);
+	}
+	return result;
+}
+
+std::chrono::microseconds RequestQueue::GetLatencyBucketUpperBound(int bucket) {
+	return std::chrono::microseconds(int64_t{1} << bucket);
+}
+
+void RequestQueue::RecordRequest(size_t found_count, Clock::duration latency) {
+	const uint64_t hits = std::min<uint64_t>(found_count, UINT32_MAX);
+	const uint64_t slot = slot_used_ | (static_cast<uint64_t>(GetLatencyBucket(latency)) << 32) | hits;
+	const size_t index = next_slot_.fetch_add(1, std::memory_order_relaxed) % sec_in_day_;
+	// exchange гарантирует, что каждое вытесненное состояние вычитается ровно один раз,
+	// даже если несколько потоков попали в один слот
+	const uint64_t evicted = slots_[index].exchange(slot, std::memory_order_acq_rel);
+	ApplySlot(slot, 1);
+	if (evicted & slot_used_) {
+		ApplySlot(evicted, -1);
+	}
+}
+
+void RequestQueue::ApplySlot(uint64_t slot, int delta) {
+	const int64_t hits = slot & UINT32_MAX;
+	const int bucket = (slot >> 32) & 0xFF;
+	request_count_.fetch_add(delta, std::memory_order_relaxed);
+	if (hits == 0) {
+		empty_count_.fetch_add(delta, std::memory_order_relaxed);
+	}
+	hit_count_.fetch_add(delta * hits, std::memory_order_relaxed);
+	latency_histogram_[bucket].fetch_add(delta, std::memory_order_relaxed);
+}
+
+int RequestQueue::GetLatencyBucket(Clock::duration latency) {
+	const auto micros = std::chrono::duration_cast<std::chrono::microseconds>(latency).count();
+	int bucket = 0;
+	while (bucket + 1 < LATENCY_BUCKET_COUNT && (int64_t{1} << bucket) <= micros) {
+		++bucket;
+	}
+	return bucket;
+}
@@ -1,43 +1,53 @@
 #pragma once
-#include <deque>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
 #include <vector>
 #include "search_server.h"
 
+// Скользящее окно последних sec_in_day_ запросов. Вместо результатов в кольце хранится
+// упакованное состояние слота, поэтому AddFindRequest можно вызывать из многих потоков без общей блокировки.
 class RequestQueue {
 public:
+	static const int LATENCY_BUCKET_COUNT = 32;
+	using LatencyHistogram = std::array<int, LATENCY_BUCKET_COUNT>;
+
 	explicit RequestQueue(const SearchServer& search_server);
 	template <typename DocumentPredicate>
 	std::vector<Document> AddFindRequest(const std::string& raw_query, DocumentPredicate document_predicate);
 	std::vector<Document> AddFindRequest(const std::string& raw_query, DocumentStatus status);
 	std::vector<Document> AddFindRequest(const std::string& raw_query);
 	int GetNoResultRequests() const;
+	int GetRequestCount() const;
+	int64_t GetHitCount() const;
+	// bucket i содержит запросы с латентностью в [2^(i-1), 2^i) мкс, bucket 0 — меньше 1 мкс
+	LatencyHistogram GetLatencyHistogram() const;
+	static std::chrono::microseconds GetLatencyBucketUpperBound(int bucket);
 private:
-	struct QueryResult {
-		std::vector<Document> found_documents;
-		bool empty_docs = false;
-	};
-	std::deque<QueryResult> requests_;
-	const static int sec_in_day_ = 1440;
+	using Clock = std::chrono::steady_clock;
+
+	// слот: бит 63 — занят, биты 32..39 — bucket латентности, младшие 32 бита — число найденных документов
+	static const uint64_t slot_used_ = uint64_t{1} << 63;
+	static const int sec_in_day_ = 1440;
+
+	void RecordRequest(size_t found_count, Clock::duration latency);
+	void ApplySlot(uint64_t slot, int delta);
+	static int GetLatencyBucket(Clock::duration latency);
+
 	const SearchServer& server_;
-	uint empty_count = 0;
+	std::array<std::atomic<uint64_t>, sec_in_day_> slots_{};
+	std::atomic<uint64_t> next_slot_{0};
+	std::atomic<int> request_count_{0};
+	std::atomic<int> empty_count_{0};
+	std::atomic<int64_t> hit_count_{0};
+	std::array<std::atomic<int>, LATENCY_BUCKET_COUNT> latency_histogram_{};
 };
 
 template <typename DocumentPredicate>
 std::vector<Document> RequestQueue::AddFindRequest(const std::string& raw_query, DocumentPredicate document_predicate) {
-	if(!requests_.empty()) {
-		while(requests_.size() >= sec_in_day_){
-			if(requests_.front().empty_docs) {
-				--empty_count;
-			}
-			requests_.pop_front();
-		}
-	}
-	QueryResult result;
-	result.found_documents = server_.FindTopDocuments(raw_query, document_predicate);
-	if(result.found_documents.empty()) {
-		++empty_count;
-		result.empty_docs = true;
-	}
-	requests_.push_back(result);
-	return result.found_documents;
-}
\ No newline at end of file
+	const auto start_time = Clock::now();
+	std::vector<Document> found_documents = server_.FindTopDocuments(raw_query, document_predicate);
+	RecordRequest(found_documents.size(), Clock::now() - start_time);
+	return found_documents;
+}
@@ -0,0 +1,223 @@
+#include "search_metrics.h"
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+
+using namespace std::string_literals;
+
+namespace {
+
+using Bucket = std::atomic<uint64_t>;
+
+struct ThreadMetrics {
+	std::array<Bucket, MetricsSnapshot::COUNTER_COUNT> counters{};
+	std::array<std::array<Bucket, MetricsSnapshot::HISTOGRAM_BUCKET_COUNT>, MetricsSnapshot::TIMER_COUNT> buckets{};
+	std::array<Bucket, MetricsSnapshot::TIMER_COUNT> totals{};
+
+	void AddTo(MetricsSnapshot& snapshot) const {
+		for (int i = 0; i < MetricsSnapshot::COUNTER_COUNT; ++i) {
+			snapshot.counters[i] += counters[i].load(std::memory_order_relaxed);
+		}
+		for (int timer = 0; timer < MetricsSnapshot::TIMER_COUNT; ++timer) {
+			auto& histogram = snapshot.timers[timer];
+			histogram.total_ns += totals[timer].load(std::memory_order_relaxed);
+			for (int i = 0; i < MetricsSnapshot::HISTOGRAM_BUCKET_COUNT; ++i) {
+				const uint64_t count = buckets[timer][i].load(std::memory_order_relaxed);
+				histogram.buckets[i] += count;
+				histogram.count += count;
+			}
+		}
+	}
+};
+
+struct Registry {
+	std::mutex mutex;
+	std::vector<ThreadMetrics*> threads;
+	// метрики завершившихся потоков
+	MetricsSnapshot retired;
+	// сумма на момент ResetMetrics. Счётчики потоков только растут, и пишет их только владелец,
+	// поэтому сброс вычитает эту сумму, а не обнуляет чужие счётчики
+	MetricsSnapshot baseline;
+};
+
+// не разрушается: потоки пула могут завершаться после статических объектов
+Registry& GetRegistry() {
+	static Registry* registry = new Registry;
+	return *registry;
+}
+
+struct ThreadMetricsHolder {
+	ThreadMetrics metrics;
+
+	ThreadMetricsHolder() {
+		Registry& registry = GetRegistry();
+		std::lock_guard guard(registry.mutex);
+		registry.threads.push_back(&metrics);
+	}
+
+	~ThreadMetricsHolder() {
+		Registry& registry = GetRegistry();
+		std::lock_guard guard(registry.mutex);
+		metrics.AddTo(registry.retired);
+		registry.threads.erase(std::find(registry.threads.begin(), registry.threads.end(), &metrics));
+	}
+};
+
+ThreadMetrics& GetThreadMetrics() {
+	thread_local ThreadMetricsHolder holder;
+	return holder.metrics;
+}
+
+void Increase(Bucket& bucket, uint64_t value) {
+	bucket.store(bucket.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+MetricsSnapshot CollectTotals(const Registry& registry) {
+	MetricsSnapshot result = registry.retired;
+	for (const ThreadMetrics* metrics : registry.threads) {
+		metrics->AddTo(result);
+	}
+	return result;
+}
+
+void Subtract(MetricsSnapshot& snapshot, const MetricsSnapshot& baseline) {
+	for (int i = 0; i < MetricsSnapshot::COUNTER_COUNT; ++i) {
+		snapshot.counters[i] -= baseline.counters[i];
+	}
+	for (int timer = 0; timer < MetricsSnapshot::TIMER_COUNT; ++timer) {
+		auto& histogram = snapshot.timers[timer];
+		const auto& baseline_histogram = baseline.timers[timer];
+		histogram.count -= baseline_histogram.count;
+		histogram.total_ns -= baseline_histogram.total_ns;
+		for (int i = 0; i < MetricsSnapshot::HISTOGRAM_BUCKET_COUNT; ++i) {
+			histogram.buckets[i] -= baseline_histogram.buckets[i];
+		}
+	}
+}
+
+int GetBucketIndex(uint64_t nanoseconds) {
+	int index = 0;
+	while (nanoseconds > 0 && index + 1 < MetricsSnapshot::HISTOGRAM_BUCKET_COUNT) {
+		nanoseconds >>= 1;
+		++index;
+	}
+	return index;
+}
+
+}
+
+uint64_t MetricsSnapshot::Histogram::GetPercentileUpperBound(double fraction) const {
+	const uint64_t rank = static_cast<uint64_t>(fraction * count);
+	uint64_t seen = 0;
+	for (int i = 0; i < HISTOGRAM_BUCKET_COUNT; ++i) {
+		seen += buckets[i];
+		if (seen > rank) {
+			return uint64_t{1} << i;
+		}
+	}
+	return count == 0 ? 0 : uint64_t{1} << (HISTOGRAM_BUCKET_COUNT - 1);
+}
+
+uint64_t MetricsSnapshot::Get(MetricCounter counter) const {
+	return counters[static_cast<int>(counter)];
+}
+
+const MetricsSnapshot::Histogram& MetricsSnapshot::Get(MetricTimer timer) const {
+	return timers[static_cast<int>(timer)];
+}
+
+void MetricsSnapshot::Print(std::ostream& out, MetricsFormat format) const {
+	if (format == MetricsFormat::TEXT) {
+		for (int i = 0; i < COUNTER_COUNT; ++i) {
+			out << GetMetricName(static_cast<MetricCounter>(i)) << " "s << counters[i] << "\n"s;
+		}
+		for (int i = 0; i < TIMER_COUNT; ++i) {
+			const Histogram& histogram = timers[i];
+			const std::string name = GetMetricName(static_cast<MetricTimer>(i));
+			out << name << "_count "s << histogram.count << "\n"s
+				<< name << "_total_ns "s << histogram.total_ns << "\n"s
+				<< name << "_p50_ns "s << histogram.GetPercentileUpperBound(0.5) << "\n"s
+				<< name << "_p99_ns "s << histogram.GetPercentileUpperBound(0.99) << "\n"s;
+		}
+		return;
+	}
+	out << "{\"counters\": {"s;
+	for (int i = 0; i < COUNTER_COUNT; ++i) {
+		out << (i > 0 ? ", "s : ""s) << "\""s << GetMetricName(static_cast<MetricCounter>(i)) << "\": "s << counters[i];
+	}
+	out << "}, \"timers\": {"s;
+	for (int i = 0; i < TIMER_COUNT; ++i) {
+		const Histogram& histogram = timers[i];
+		out << (i > 0 ? ", "s : ""s) << "\""s << GetMetricName(static_cast<MetricTimer>(i)) << "\": {"s
+			<< "\"count\": "s << histogram.count
+			<< ", \"total_ns\": "s << histogram.total_ns
+			<< ", \"p50_ns\": "s << histogram.GetPercentileUpperBound(0.5)
+			<< ", \"p99_ns\": "s << histogram.GetPercentileUpperBound(0.99)
+			<< ", \"buckets\": ["s;
+		for (int j = 0; j < HISTOGRAM_BUCKET_COUNT; ++j) {
+			out << (j > 0 ? ", "s : ""s) << histogram.buckets[j];
+		}
+		out << "]}"s;
+	}
+	out << "}}"s;
+}
+
+const char* GetMetricName(MetricCounter counter) {
+	switch (counter) {
+	case MetricCounter::QUERIES:
+		return "queries";
+	case MetricCounter::POSTINGS_SCANNED:
+		return "postings_scanned";
+	case MetricCounter::DOCUMENTS_SCORED:
+		return "documents_scored";
+	case MetricCounter::MINUS_WORD_EXCLUSIONS:
+		return "minus_word_exclusions";
+	case MetricCounter::PREFIX_CACHE_HITS:
+		return "prefix_cache_hits";
+	case MetricCounter::PREFIX_CACHE_MISSES:
+		return "prefix_cache_misses";
+	case MetricCounter::COUNT:
+		break;
+	}
+	return "unknown";
+}
+
+const char* GetMetricName(MetricTimer timer) {
+	switch (timer) {
+	case MetricTimer::PARSE_QUERY:
+		return "parse_query";
+	case MetricTimer::SELECT_TOP:
+		return "select_top";
+	case MetricTimer::COUNT:
+		break;
+	}
+	return "unknown";
+}
+
+void AddMetric(MetricCounter counter, uint64_t value) {
+	Increase(GetThreadMetrics().counters[static_cast<int>(counter)], value);
+}
+
+void RecordMetric(MetricTimer timer, std::chrono::nanoseconds duration) {
+	ThreadMetrics& metrics = GetThreadMetrics();
+	const uint64_t nanoseconds = std::max<int64_t>(duration.count(), 0);
+	Increase(metrics.buckets[static_cast<int>(timer)][GetBucketIndex(nanoseconds)], 1);
+	Increase(metrics.totals[static_cast<int>(timer)], nanoseconds);
+}
+
+MetricsSnapshot CollectMetrics() {
+	Registry& registry = GetRegistry();
+	std::lock_guard guard(registry.mutex);
+	MetricsSnapshot result = CollectTotals(registry);
+	Subtract(result, registry.baseline);
+	return result;
+}
+
+void ResetMetrics() {
+	Registry& registry = GetRegistry();
+	std::lock_guard guard(registry.mutex);
+	registry.baseline = CollectTotals(registry);
+}
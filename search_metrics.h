@@ -0,0 +1,89 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include "log_duration.h"
+
+// Сборка с -DSEARCH_SERVER_METRICS=0 убирает замеры из кода запросов полностью
+#ifndef SEARCH_SERVER_METRICS
+#define SEARCH_SERVER_METRICS 1
+#endif
+
+enum class MetricCounter {
+	QUERIES,
+	POSTINGS_SCANNED,
+	DOCUMENTS_SCORED,
+	MINUS_WORD_EXCLUSIONS,
+	// списки слов для "prefix*" из кэша сервера и построенные заново (только кэшируемые длины)
+	PREFIX_CACHE_HITS,
+	PREFIX_CACHE_MISSES,
+	COUNT,
+};
+
+enum class MetricTimer {
+	PARSE_QUERY,
+	SELECT_TOP,
+	COUNT,
+};
+
+enum class MetricsFormat {
+	TEXT,
+	JSON,
+};
+
+// Сумма метрик всех потоков на момент вызова CollectMetrics
+struct MetricsSnapshot {
+	static const int HISTOGRAM_BUCKET_COUNT = 40;
+	static const int COUNTER_COUNT = static_cast<int>(MetricCounter::COUNT);
+	static const int TIMER_COUNT = static_cast<int>(MetricTimer::COUNT);
+
+	// bucket i содержит длительности из [2^(i-1), 2^i) нс, bucket 0 — нулевые
+	struct Histogram {
+		uint64_t count = 0;
+		uint64_t total_ns = 0;
+		std::array<uint64_t, HISTOGRAM_BUCKET_COUNT> buckets{};
+
+		// верхняя граница bucket, в который попадает перцентиль fraction
+		uint64_t GetPercentileUpperBound(double fraction) const;
+	};
+
+	std::array<uint64_t, COUNTER_COUNT> counters{};
+	std::array<Histogram, TIMER_COUNT> timers{};
+
+	uint64_t Get(MetricCounter counter) const;
+	const Histogram& Get(MetricTimer timer) const;
+	void Print(std::ostream& out, MetricsFormat format) const;
+};
+
+const char* GetMetricName(MetricCounter counter);
+const char* GetMetricName(MetricTimer timer);
+
+// значения пишет только поток-владелец, поэтому запись обходится без блокировок и атомарных RMW
+void AddMetric(MetricCounter counter, uint64_t value);
+void RecordMetric(MetricTimer timer, std::chrono::nanoseconds duration);
+MetricsSnapshot CollectMetrics();
+void ResetMetrics();
+
+class MetricTimerGuard {
+public:
+	explicit MetricTimerGuard(MetricTimer timer) : timer_(timer) {
+	}
+
+	~MetricTimerGuard() {
+		RecordMetric(timer_, LogDuration::Clock::now() - start_time_);
+	}
+
+private:
+	const MetricTimer timer_;
+	const LogDuration::Clock::time_point start_time_ = LogDuration::Clock::now();
+};
+
+#if SEARCH_SERVER_METRICS
+#define SEARCH_METRIC_ADD(counter, value) AddMetric(MetricCounter::counter, (value))
+#define SEARCH_METRIC_TIMER(timer) MetricTimerGuard PROFILE_CONCAT(metricGuard, __LINE__)(MetricTimer::timer)
+#else
+#define SEARCH_METRIC_ADD(counter, value) static_cast<void>(0)
+#define SEARCH_METRIC_TIMER(timer) static_cast<void>(0)
+#endif
@@ -1,59 +1,596 @@
 #include "search_server.h"
 
 
-SearchServer::SearchServer(std::string_view stop_words_text)
-: SearchServer(SplitIntoWords(stop_words_text)) {
+SearchServer::SearchServer(std::string_view stop_words_text, const IndexOptions& options)
+: SearchServer(SplitIntoWords(stop_words_text), options) {
 }
 
-SearchServer::SearchServer(const std::string& stop_words_text)
-: SearchServer(SplitIntoWords(stop_words_text)) {
+SearchServer::SearchServer(const std::string& stop_words_text, const IndexOptions& options)
+: SearchServer(SplitIntoWords(stop_words_text), options) {
+}
+
+SearchServer::SearchServer(const SearchServer& other)
+: options_(other.options_)
+, stop_words_(other.stop_words_)
+, word_to_document_freqs_(other.word_to_document_freqs_)
+, documents_(other.documents_)
+, total_document_length_(other.total_document_length_)
+, executor_(other.executor_ ? std::make_unique<ThreadPool>(other.executor_->GetOptions()) : nullptr) {
+	for (const auto& [document_id, word_freqs] : other.id_freqs_word_) {
+		auto& own_word_freqs = id_freqs_word_[document_id];
+		for (const auto& [word, term_freq] : word_freqs) {
+			own_word_freqs.emplace(word_to_document_freqs_.find(word)->first, term_freq);
+		}
+	}
+	for (const auto& [word, positions] : other.word_positions_) {
+		word_positions_.emplace(word_to_document_freqs_.find(word)->first, positions);
+	}
+}
+
+SearchServer::SearchServer(SearchServer&& other)
+: options_(other.options_)
+, stop_words_(other.stop_words_)
+, executor_(other.executor_ ? std::make_unique<ThreadPool>(other.executor_->GetOptions()) : nullptr) {
+	other.executor_.reset();
+	// узлы map при перемещении остаются на месте, поэтому string_view прямого индекса не портятся
+	word_to_document_freqs_ = std::move(other.word_to_document_freqs_);
+	documents_ = std::move(other.documents_);
+	id_freqs_word_ = std::move(other.id_freqs_word_);
+	word_positions_ = std::move(other.word_positions_);
+	total_document_length_ = std::exchange(other.total_document_length_, 0);
+	// кэш источника ссылается на слова, которые теперь принадлежат этому серверу
+	other.ClearPrefixCache();
 }
 
 void SearchServer::AddDocument(int document_id, const std::string_view& document, DocumentStatus status, const std::vector<int>& ratings) {
 	if ((document_id < 0) || (documents_.count(document_id) > 0)) {
 		throw std::invalid_argument("Invalid document_id"s);
 	}
-	const auto words = SplitIntoWordsNoStop(document);
-	const double inv_word_count = 1.0 / words.size();
-	for (const std::string& word : words) {
-		word_to_document_freqs_[word][document_id] += inv_word_count;
-		id_freqs_word_[document_id][word] +=inv_word_count;
+	if (!options_.positions) {
+		AddTokenizedDocument(document_id, TokenizeDocument(document), status, ratings);
+		return;
 	}
-	documents_.emplace(document_id, DocumentData{ComputeAverageRating(ratings), status});
-	document_ids_.insert(document_id);
+	std::vector<uint32_t> positions;
+	const auto words = TokenizeDocument(document, &positions);
+	AddTokenizedDocument(document_id, words, status, ratings, positions);
 }
 
-std::vector<Document> SearchServer::FindTopDocuments(const std::string_view raw_query, DocumentStatus status) const {
-	return FindTopDocuments(raw_query, [status](int, DocumentStatus document_status, int) {
-		return document_status == status;
+std::vector<std::string_view> SearchServer::TokenizeDocument(const std::string_view document, std::vector<uint32_t>* positions) const {
+	std::vector<std::string_view> words;
+	if (positions != nullptr) {
+		positions->clear();
+	}
+	uint32_t position = 0;
+	for (const std::string_view word : SplitIntoWords(document)) {
+		if (!IsValidWord(word)) {
+			throw std::invalid_argument("Word "s + std::string(word) + " is invalid"s);
+		}
+		if (!IsStopWord(word)) {
+			words.push_back(word);
+			if (positions != nullptr) {
+				positions->push_back(position);
+			}
+		}
+		++position;
+	}
+	return words;
+}
+
+void SearchServer::AddTokenizedDocument(int document_id, const std::vector<std::string_view>& words, DocumentStatus status, const std::vector<int>& ratings,
+	const std::vector<uint32_t>& positions) {
+	if (options_.positions && positions.size() != words.size()) {
+		throw std::invalid_argument("Positions of document words are required"s);
+	}
+	AddTokenizedDocument(document_id, GroupDocumentWords(words, options_.positions ? positions : std::vector<uint32_t>()), status, ratings);
+}
+
+SearchServer::TokenizedDocument SearchServer::GroupDocumentWords(const std::vector<std::string_view>& words, const std::vector<uint32_t>& positions) {
+	if (!positions.empty() && positions.size() != words.size()) {
+		throw std::invalid_argument("Positions of document words are required"s);
+	}
+	// устойчивая сортировка сохраняет позиции каждого слова по возрастанию
+	std::vector<uint32_t> order(words.size());
+	std::iota(order.begin(), order.end(), 0);
+	std::stable_sort(order.begin(), order.end(), [&words](uint32_t lhs, uint32_t rhs) {
+		return words[lhs] < words[rhs];
 	});
+	TokenizedDocument result;
+	result.length = words.size();
+	result.positions.reserve(positions.size());
+	for (const uint32_t index : order) {
+		if (result.terms.empty() || result.terms.back().word != words[index]) {
+			result.terms.push_back({words[index], 0});
+		}
+		++result.terms.back().count;
+		if (!positions.empty()) {
+			result.positions.push_back(positions[index]);
+		}
+	}
+	return result;
+}
+
+void SearchServer::AddTokenizedDocument(int document_id, const TokenizedDocument& document, DocumentStatus status, const std::vector<int>& ratings) {
+	if ((document_id < 0) || (documents_.count(document_id) > 0)) {
+		throw std::invalid_argument("Invalid document_id"s);
+	}
+	if (options_.positions && document.positions.size() != document.length) {
+		throw std::invalid_argument("Positions of document words are required"s);
+	}
+	ClearPrefixCache();
+	const double inv_word_count = 1.0 / document.length;
+	std::map<std::string_view, double>* word_freqs = options_.forward_index && !document.terms.empty() ? &id_freqs_word_[document_id] : nullptr;
+	auto positions = document.positions.begin();
+	for (const auto& [word, count] : document.terms) {
+		auto it = word_to_document_freqs_.find(word);
+		if (it == word_to_document_freqs_.end()) {
+			it = word_to_document_freqs_.emplace(std::string(word), PostingList()).first;
+		}
+		// та же сумма, что при добавлении по одному вхождению, — частоты не зависят от пути добавления
+		double term_freq = 0.0;
+		for (uint32_t i = 0; i < count; ++i) {
+			term_freq += inv_word_count;
+		}
+		it->second.Add(document_id, term_freq, document.length);
+		if (word_freqs != nullptr) {
+			word_freqs->emplace_hint(word_freqs->end(), it->first, term_freq);
+		}
+		if (options_.positions) {
+			word_positions_[it->first].Add(document_id, std::vector<uint32_t>(positions, positions + count));
+			positions += count;
+		}
+	}
+	documents_.emplace(document_id, DocumentData{ComputeAverageRating(ratings), status, document.length});
+	total_document_length_ += document.length;
+}
+
+const IndexOptions& SearchServer::GetIndexOptions() const {
+	return options_;
+}
+
+void SearchServer::AddStopWord(const std::string_view word) {
+	if (word.empty() || !IsValidWord(word)) {
+		throw std::invalid_argument("Stop word "s + std::string(word) + " is invalid"s);
+	}
+	if (stop_words_.Add(word)) {
+		ClearPrefixCache();
+	}
+}
+
+void SearchServer::RemoveStopWord(const std::string_view word) {
+	if (!stop_words_.Remove(word)) {
+		return;
+	}
+	ClearPrefixCache();
+	// иначе слово снова нашлось бы в старых документах, где оно уже не учитывалось
+	const auto it = word_to_document_freqs_.find(word);
+	if (it != word_to_document_freqs_.end()) {
+		PurgeTerm(it);
+	}
+}
+
+void SearchServer::PurgeStopWords() {
+	for (const std::string_view word : stop_words_.GetWords()) {
+		const auto it = word_to_document_freqs_.find(word);
+		if (it != word_to_document_freqs_.end()) {
+			PurgeTerm(it);
+		}
+	}
+}
+
+void SearchServer::PurgeTerm(std::map<std::string, PostingList, std::less<>>::iterator term) {
+	// ключи прямого индекса и позиций ссылаются на строку слова, поэтому они удаляются первыми
+	if (options_.forward_index) {
+		for (const PostingList::Posting& posting : term->second) {
+			id_freqs_word_.at(posting.document_id).erase(term->first);
+		}
+	}
+	word_positions_.erase(term->first);
+	word_to_document_freqs_.erase(term);
+}
+
+std::vector<Document> SearchServer::FindTopDocuments(const std::string_view raw_query, DocumentStatus status) const {
+	return FindTopDocuments<TfIdf>(raw_query, status);
 }
 std::vector<Document> SearchServer::FindTopDocuments(const std::string_view raw_query) const {
-	return FindTopDocuments(raw_query, DocumentStatus::ACTUAL);
+	return FindTopDocuments<TfIdf>(raw_query);
+}
+
+std::vector<Document> SearchServer::FindTopDocuments(const std::string_view raw_query, size_t page, size_t page_size) const {
+	return FindTopDocuments<TfIdf>(raw_query, page, page_size);
+}
+
+SearchServer::DocumentCursor SearchServer::FindDocumentPages(const std::string_view raw_query, size_t page_size) const {
+	return FindDocumentPages<TfIdf>(raw_query, page_size);
+}
+
+void SearchServer::TermStatistics::Merge(const TermStatistics& other) {
+	document_count += other.document_count;
+	total_document_length += other.total_document_length;
+	for (const auto& [word, document_freq] : other.document_freqs) {
+		document_freqs[word] += document_freq;
+	}
+	for (const auto& [prefix, words] : other.prefix_words) {
+		auto& own_words = prefix_words[prefix];
+		std::vector<std::string> merged_words;
+		merged_words.reserve(own_words.size() + words.size());
+		std::set_union(own_words.begin(), own_words.end(), words.begin(), words.end(), std::back_inserter(merged_words));
+		own_words = std::move(merged_words);
+	}
+}
+
+SearchServer::TermStatistics SearchServer::GetTermStatistics(const std::string_view raw_query) const {
+	TermStatistics result;
+	result.document_count = GetDocumentCount();
+	result.total_document_length = total_document_length_;
+	const auto query = ParseQuery(raw_query);
+	for (const std::string& word : query.plus_words) {
+		const auto it = word_to_document_freqs_.find(word);
+		result.document_freqs[word] = it == word_to_document_freqs_.end() ? 0 : it->second.size();
+	}
+	// общие самые частые слова префикса могут быть не самыми частыми здесь, поэтому передаются все
+	for (const QueryPrefix& prefix : query.plus_prefixes) {
+		const auto [it, inserted] = result.prefix_words.try_emplace(prefix.prefix);
+		if (!inserted) {
+			continue;
+		}
+		for (const PrefixCandidate& candidate : *GetPrefixCandidates(prefix.prefix)) {
+			it->second.emplace_back(candidate.word);
+			result.document_freqs[std::string(candidate.word)] = candidate.document_freq;
+		}
+		std::sort(it->second.begin(), it->second.end());
+	}
+	return result;
+}
+
+void SearchServer::ConfigureExecutor(const ThreadPool::Options& options) {
+	executor_ = std::make_unique<ThreadPool>(options);
+}
+
+std::future<std::vector<Document>> SearchServer::FindTopDocumentsAsync(std::string raw_query, DocumentStatus status) const {
+	return VisitStatusPredicate(status, [&](auto document_predicate) {
+		return FindTopDocumentsAsync(std::move(raw_query), document_predicate);
+	});
+}
+
+std::future<std::vector<Document>> SearchServer::FindTopDocumentsAsync(std::string raw_query) const {
+	return FindTopDocumentsAsync(std::move(raw_query), DocumentStatus::ACTUAL);
+}
+
+bool SearchServer::TrySubmitFindTopDocuments(std::string raw_query, SearchCallback callback) const {
+	return GetExecutor().TrySubmit([this, raw_query = std::move(raw_query), callback = std::move(callback)] {
+		std::vector<Document> result;
+		std::exception_ptr error;
+		try {
+			result = FindTopDocuments(raw_query);
+		} catch (...) {
+			error = std::current_exception();
+		}
+		callback(std::move(result), error);
+	});
+}
+
+ThreadPool& SearchServer::GetExecutor() const {
+	if (!executor_) {
+		throw std::logic_error("Executor is not configured"s);
+	}
+	return *executor_;
 }
 
 int SearchServer::GetDocumentCount() const {
 	return documents_.size();
 }
 
-std::set<int>::const_iterator SearchServer::begin() const{
-	return document_ids_.cbegin();
+SearchServer::DocumentIdIterator SearchServer::begin() const{
+	return DocumentIdIterator(documents_.cbegin());
 }
 
-std::set<int>::const_iterator SearchServer::end() const{
-	return document_ids_.cend();
+SearchServer::DocumentIdIterator SearchServer::end() const{
+	return DocumentIdIterator(documents_.cend());
 }
 
 const std::map<std::string_view, double>& SearchServer::GetWordFrequencies(int document_id) const{
-	static std::map<std::string_view,double> result;
-	if (id_freqs_word_.count(document_id)) {
-		for (const std::pair<std::string_view, double>& word_freq : id_freqs_word_.at(document_id)) {
-			result.insert(word_freq);
+	static const std::map<std::string_view, double> empty_result;
+	if (!options_.forward_index) {
+		throw std::logic_error("Forward index is disabled"s);
+	}
+	const auto it = id_freqs_word_.find(document_id);
+	return it == id_freqs_word_.end() ? empty_result : it->second;
+}
+
+namespace {
+
+// узел std::map: цвет и три указателя плюс значение
+template <typename Key, typename Value>
+constexpr size_t MapNodeBytes() {
+	return 4 * sizeof(void*) + sizeof(std::pair<const Key, Value>);
+}
+
+size_t StringHeapBytes(const std::string& text) {
+	return text.capacity() > std::string().capacity() ? text.capacity() + 1 : 0;
+}
+
+}
+
+size_t SearchServer::MemoryUsage::GetTotal() const {
+	return stop_words + term_dictionary + postings + forward_index + positions + documents;
+}
+
+SearchServer::MemoryUsage SearchServer::GetMemoryUsage() const {
+	MemoryUsage result;
+	result.stop_words = stop_words_.GetMemoryUsage();
+	for (const auto& [word, postings] : word_to_document_freqs_) {
+		result.term_dictionary += MapNodeBytes<std::string, PostingList>() + StringHeapBytes(word);
+		result.postings += postings.GetMemoryUsage();
+	}
+	for (const auto& [document_id, word_freqs] : id_freqs_word_) {
+		result.forward_index += MapNodeBytes<int, std::map<std::string_view, double>>()
+			+ word_freqs.size() * MapNodeBytes<std::string_view, double>();
+	}
+	for (const auto& [_, positions] : word_positions_) {
+		result.positions += MapNodeBytes<std::string_view, PositionList>() + positions.GetMemoryUsage();
+	}
+	result.documents = documents_.size() * MapNodeBytes<int, DocumentData>();
+	return result;
+}
+
+void SearchServer::ShrinkToFit() {
+	PurgeStopWords();
+	for (auto& [_, postings] : word_to_document_freqs_) {
+		postings.ShrinkToFit();
+	}
+	for (auto& [_, positions] : word_positions_) {
+		positions.ShrinkToFit();
+	}
+}
+
+SearchServer::IndexGauges SearchServer::GetIndexGauges() const {
+	IndexGauges result;
+	result.documents = documents_.size();
+	result.terms = word_to_document_freqs_.size();
+	for (const auto& [_, postings] : word_to_document_freqs_) {
+		result.postings += postings.size();
+	}
+	result.memory = GetMemoryUsage();
+	return result;
+}
+
+namespace {
+
+const uint32_t SNAPSHOT_MAGIC = 0x53535359;
+// 2: длина документа
+const uint32_t SNAPSHOT_VERSION = 2;
+// строка неизвестного размера читается такими кусками, чтобы память росла вместе с прочитанным
+const size_t SNAPSHOT_STRING_CHUNK_SIZE = 1 << 16;
+
+template <typename T>
+void WriteValue(std::ostream& out, T value) {
+	out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void WriteString(std::ostream& out, const std::string_view text) {
+	WriteValue<uint32_t>(out, text.size());
+	out.write(text.data(), text.size());
+}
+
+// Читает снимок, не доверяя записанным в нём размерам: длина строки и число элементов
+// сверяются с остатком потока, поэтому испорченный файл не приводит к огромным выделениям памяти
+class SnapshotReader {
+public:
+	explicit SnapshotReader(std::istream& in)
+		: in_(in) {
+		const auto position = in_.tellg();
+		if (position != std::istream::pos_type(-1) && in_.seekg(0, std::ios::end)) {
+			remaining_ = static_cast<uint64_t>(in_.tellg() - position);
+			in_.seekg(position);
+		} else {
+			// поток без позиционирования: размеры проверить не с чем
+			in_.clear();
 		}
 	}
+
+	template <typename T>
+	T ReadValue() {
+		T value;
+		Read(reinterpret_cast<char*>(&value), sizeof(value));
+		return value;
+	}
+
+	// число элементов, каждый из которых занимает в снимке не меньше min_element_size байт
+	uint32_t ReadCount(size_t min_element_size) {
+		const uint32_t count = ReadValue<uint32_t>();
+		if (remaining_ && static_cast<uint64_t>(count) * min_element_size > *remaining_) {
+			throw std::runtime_error("Corrupt snapshot element count"s);
+		}
+		return count;
+	}
+
+	std::string ReadString() {
+		const uint32_t size = ReadCount(1);
+		std::string text;
+		while (text.size() < size) {
+			const size_t offset = text.size();
+			text.resize(offset + std::min<size_t>(size - offset, SNAPSHOT_STRING_CHUNK_SIZE));
+			Read(text.data() + offset, text.size() - offset);
+		}
+		return text;
+	}
+
+	DocumentStatus ReadStatus() {
+		const auto status = ReadValue<uint8_t>();
+		if (status > static_cast<uint8_t>(DocumentStatus::REMOVED)) {
+			throw std::runtime_error("Unknown document status in snapshot"s);
+		}
+		return static_cast<DocumentStatus>(status);
+	}
+
+private:
+	void Read(char* data, size_t size) {
+		if (!in_.read(data, size)) {
+			throw std::runtime_error("Snapshot is truncated"s);
+		}
+		if (remaining_) {
+			*remaining_ -= size;
+		}
+	}
+
+	std::istream& in_;
+	std::optional<uint64_t> remaining_;
+};
+
+}
+
+void SearchServer::SaveSnapshot(std::ostream& out) const {
+	WriteValue(out, SNAPSHOT_MAGIC);
+	WriteValue(out, SNAPSHOT_VERSION);
+	WriteValue<uint8_t>(out, options_.forward_index);
+	WriteValue<uint8_t>(out, options_.positions);
+	WriteValue<uint32_t>(out, stop_words_.size());
+	for (const std::string_view word : stop_words_.GetWords()) {
+		WriteString(out, word);
+	}
+	WriteValue<uint32_t>(out, documents_.size());
+	for (const auto& [document_id, document_data] : documents_) {
+		WriteValue<int32_t>(out, document_id);
+		WriteValue<int32_t>(out, document_data.rating);
+		WriteValue<uint8_t>(out, static_cast<uint8_t>(document_data.status));
+		WriteValue<uint32_t>(out, document_data.length);
+	}
+	// ещё не удалённые вхождения стоп-слов в снимок не попадают
+	std::vector<uint32_t> positions;
+	WriteValue<uint32_t>(out, std::count_if(word_to_document_freqs_.begin(), word_to_document_freqs_.end(), [this](const auto& term) {
+		return !IsStopWord(term.first);
+	}));
+	for (const auto& [word, postings] : word_to_document_freqs_) {
+		if (IsStopWord(word)) {
+			continue;
+		}
+		WriteString(out, word);
+		WriteValue<uint32_t>(out, postings.size());
+		const PositionList* word_positions = options_.positions ? FindPositions(word) : nullptr;
+		for (const PostingList::Posting& posting : postings) {
+			WriteValue<int32_t>(out, posting.document_id);
+			WriteValue<double>(out, posting.term_freq);
+			if (word_positions != nullptr) {
+				word_positions->Get(posting.document_id, positions);
+				WriteValue<uint32_t>(out, positions.size());
+				for (const uint32_t position : positions) {
+					WriteValue(out, position);
+				}
+			}
+		}
+	}
+	if (!out) {
+		throw std::runtime_error("Cannot write snapshot"s);
+	}
+}
+
+SearchServer SearchServer::LoadSnapshot(std::istream& in) {
+	SnapshotReader reader(in);
+	if (reader.ReadValue<uint32_t>() != SNAPSHOT_MAGIC || reader.ReadValue<uint32_t>() != SNAPSHOT_VERSION) {
+		throw std::runtime_error("Unsupported snapshot format"s);
+	}
+	IndexOptions options;
+	options.forward_index = reader.ReadValue<uint8_t>() != 0;
+	options.positions = reader.ReadValue<uint8_t>() != 0;
+	std::vector<std::string> stop_words;
+	for (uint32_t i = reader.ReadCount(sizeof(uint32_t)); i > 0; --i) {
+		stop_words.push_back(reader.ReadString());
+	}
+	SearchServer result(stop_words, options);
+	for (uint32_t i = reader.ReadCount(2 * sizeof(int32_t) + sizeof(uint8_t) + sizeof(uint32_t)); i > 0; --i) {
+		const int document_id = reader.ReadValue<int32_t>();
+		const int rating = reader.ReadValue<int32_t>();
+		const auto status = reader.ReadStatus();
+		const uint32_t length = reader.ReadValue<uint32_t>();
+		if (!result.documents_.emplace(document_id, DocumentData{rating, status, length}).second) {
+			throw std::runtime_error("Snapshot repeats document "s + std::to_string(document_id));
+		}
+		result.total_document_length_ += length;
+	}
+	// прямой индекс собирается в векторах по порядку документов: вставка в деревья
+	// в порядке обхода слов обходится в разы дороже самой загрузки
+	std::vector<int> document_ids;
+	std::vector<std::vector<std::pair<std::string_view, double>>> document_words;
+	if (options.forward_index) {
+		for (const auto& [document_id, _] : result.documents_) {
+			document_ids.push_back(document_id);
+		}
+		document_words.resize(document_ids.size());
+	}
+	const size_t posting_size = sizeof(int32_t) + sizeof(double) + (options.positions ? sizeof(uint32_t) : 0);
+	std::vector<uint32_t> positions;
+	for (uint32_t i = reader.ReadCount(2 * sizeof(uint32_t)); i > 0; --i) {
+		std::string read_word = reader.ReadString();
+		// слова записаны по возрастанию и без повторов, на этом держится сборка прямого индекса
+		if (!result.word_to_document_freqs_.empty() && result.word_to_document_freqs_.rbegin()->first >= read_word) {
+			throw std::runtime_error("Snapshot words are out of order"s);
+		}
+		auto& [word, postings] = *result.word_to_document_freqs_.emplace_hint(result.word_to_document_freqs_.end(), std::move(read_word), PostingList());
+		PositionList* word_positions = options.positions ? &result.word_positions_[word] : nullptr;
+		for (uint32_t j = reader.ReadCount(posting_size); j > 0; --j) {
+			const int document_id = reader.ReadValue<int32_t>();
+			const double term_freq = reader.ReadValue<double>();
+			const auto document = result.documents_.find(document_id);
+			if (document == result.documents_.end()) {
+				throw std::runtime_error("Snapshot refers to unknown document "s + std::to_string(document_id));
+			}
+			if (!postings.empty() && std::prev(postings.end())->document_id >= document_id) {
+				throw std::runtime_error("Snapshot postings are out of order"s);
+			}
+			postings.Add(document_id, term_freq, document->second.length);
+			if (options.forward_index) {
+				const size_t index = std::lower_bound(document_ids.begin(), document_ids.end(), document_id) - document_ids.begin();
+				document_words[index].emplace_back(word, term_freq);
+			}
+			if (word_positions != nullptr) {
+				positions.clear();
+				for (uint32_t k = reader.ReadCount(sizeof(uint32_t)); k > 0; --k) {
+					positions.push_back(reader.ReadValue<uint32_t>());
+					if (positions.size() > 1 && positions[positions.size() - 2] >= positions.back()) {
+						throw std::runtime_error("Snapshot positions are out of order"s);
+					}
+				}
+				word_positions->Add(document_id, positions);
+			}
+		}
+	}
+	// слова приходят по возрастанию, поэтому каждое дерево строится из упорядоченного диапазона
+	for (size_t i = 0; i < document_ids.size(); ++i) {
+		result.id_freqs_word_.emplace_hint(result.id_freqs_word_.end(), document_ids[i],
+			std::map<std::string_view, double>(document_words[i].begin(), document_words[i].end()));
+	}
 	return result;
 }
 
+void SearchServer::ExportIndexGauges(std::ostream& out, MetricsFormat format) const {
+	const IndexGauges gauges = GetIndexGauges();
+	const std::pair<const char*, size_t> gauge_values[] = {
+		{"index_documents", gauges.documents},
+		{"index_terms", gauges.terms},
+		{"index_postings", gauges.postings},
+		{"index_stop_words_bytes", gauges.memory.stop_words},
+		{"index_term_dictionary_bytes", gauges.memory.term_dictionary},
+		{"index_postings_bytes", gauges.memory.postings},
+		{"index_forward_index_bytes", gauges.memory.forward_index},
+		{"index_positions_bytes", gauges.memory.positions},
+		{"index_document_bytes", gauges.memory.documents},
+		{"index_total_bytes", gauges.memory.GetTotal()},
+	};
+	if (format == MetricsFormat::TEXT) {
+		for (const auto& [name, value] : gauge_values) {
+			out << name << " "s << value << "\n"s;
+		}
+		return;
+	}
+	out << "{"s;
+	bool first = true;
+	for (const auto& [name, value] : gauge_values) {
+		out << (first ? ""s : ", "s) << "\""s << name << "\": "s << value;
+		first = false;
+	}
+	out << "}"s;
+}
+
 void SearchServer::RemoveDocument(int document_id) {
 	RemoveDocument(std::execution::seq, document_id);
 }
@@ -61,25 +598,31 @@ void SearchServer::RemoveDocument(int document_id) {
 using WordsInDocument = std::tuple<std::vector<std::string_view>, DocumentStatus>;
 WordsInDocument SearchServer::MatchDocument(const std::string_view raw_query, int document_id) const {
 	const auto query = ParseQuery(raw_query);
-	std::vector<std::string_view> matched_words;
-	for (auto& word : query.plus_words) {
-		if (word_to_document_freqs_.count(word) == 0) {
-			continue;
-		}
-		if (word_to_document_freqs_.at(std::string(word)).count(document_id)) {
-			matched_words.push_back(word_to_document_freqs_.find(word)->first);
+	const DocumentStatus status = documents_.at(document_id).status;
+	for (const std::string& word : query.minus_words) {
+		const PostingList* postings = FindPostings(word);
+		if (postings != nullptr && postings->count(document_id)) {
+			return {std::vector<std::string_view>(), status};
 		}
 	}
-	for (std::string_view word : query.minus_words) {
-		if (word_to_document_freqs_.count(std::string(word)) == 0) {
-			continue;
+	for (const std::string& word : query.required_words) {
+		const PostingList* postings = FindPostings(word);
+		if (postings == nullptr || !postings->count(document_id)) {
+			return {std::vector<std::string_view>(), status};
 		}
-		if (word_to_document_freqs_.at(std::string(word)).count(document_id)) {
-			matched_words.clear();
-			break;
+	}
+	if (!MatchesPhrases(document_id, query)) {
+		return {std::vector<std::string_view>(), status};
+	}
+	// слова возвращаются как string_view на ключи индекса, запрос к этому моменту уже разрушен
+	std::vector<std::string_view> matched_words;
+	for (const std::string& word : query.plus_words) {
+		const auto it = word_to_document_freqs_.find(word);
+		if (it != word_to_document_freqs_.end() && it->second.count(document_id)) {
+			matched_words.push_back(it->first);
 		}
 	}
-	return {matched_words, documents_.at(document_id).status};
+	return {matched_words, status};
 }
 
 WordsInDocument SearchServer::MatchDocument(std::execution::sequenced_policy, const std::string_view raw_query, int document_id) const {
@@ -87,22 +630,32 @@ WordsInDocument SearchServer::MatchDocument(std::execution::sequenced_policy, co
 }
 
 WordsInDocument SearchServer::MatchDocument(std::execution::parallel_policy, const std::string_view raw_query, int document_id) const {
-	const auto query = ParseQuery(raw_query);	
-	static std::vector<std::string_view> matched_words;
- 	matched_words.reserve(query.plus_words.size());
- 	auto IsCorrectWord {[&](const std::string& word) {
- 		return word_to_document_freqs_.count(word) && word_to_document_freqs_.at(word).count(document_id);}
- 	};
-	std::copy_if(std::execution::par, query.plus_words.begin(), query.plus_words.end(),
-						std::back_inserter(matched_words), IsCorrectWord);
-	if (std::any_of(std::execution::par, query.minus_words.begin(), query.minus_words.end(), IsCorrectWord)) {
-		matched_words.clear();
+	const auto query = ParseQuery(raw_query);
+	const DocumentStatus status = documents_.at(document_id).status;
+	auto IsCorrectWord {[&](const std::string& word) {
+		const PostingList* postings = FindPostings(word);
+		return postings != nullptr && postings->count(document_id) > 0;
+	}};
+	if (std::any_of(std::execution::par, query.minus_words.begin(), query.minus_words.end(), IsCorrectWord)
+		|| !std::all_of(std::execution::par, query.required_words.begin(), query.required_words.end(), IsCorrectWord)
+		|| !MatchesPhrases(document_id, query)) {
+		return {std::vector<std::string_view>(), status};
 	}
-	return {matched_words, documents_.at(document_id).status};
+	std::vector<std::string_view> matched_words(query.plus_words.size());
+	std::transform(std::execution::par, query.plus_words.begin(), query.plus_words.end(), matched_words.begin(),
+		[&](const std::string& word) -> std::string_view {
+			const auto it = word_to_document_freqs_.find(word);
+			if (it == word_to_document_freqs_.end() || !it->second.count(document_id)) {
+				return {};
+			}
+			return it->first;
+		});
+	matched_words.erase(std::remove(matched_words.begin(), matched_words.end(), std::string_view()), matched_words.end());
+	return {matched_words, status};
 }
 
 bool SearchServer::IsStopWord(const std::string_view word) const {
-	return stop_words_.count(std::string(word)) > 0;
+	return stop_words_.Contains(word);
 }
 
 bool SearchServer::IsValidWord(const std::string_view word) {
@@ -111,20 +664,6 @@ bool SearchServer::IsValidWord(const std::string_view word) {
 	});
 }
 
-std::vector<std::string> SearchServer::SplitIntoWordsNoStop(const std::string_view text) const {
-	std::vector<std::string> words;
-	for (auto word : SplitIntoWords(text)) {
-		if (!IsValidWord(word)) {
-			std::string word_ = std::string(word);
-			throw std::invalid_argument("Word "s + word_ + " is invalid"s);
-		}
-		if (!IsStopWord(word)) {
-			words.push_back(std::string(word));
-		}
-	}
-	return words;
-}
-
 int SearchServer::ComputeAverageRating(const std::vector<int>& ratings) {
 	if (ratings.empty()) {
 		return 0;
@@ -136,39 +675,255 @@ int SearchServer::ComputeAverageRating(const std::vector<int>& ratings) {
 	return rating_sum / static_cast<int>(ratings.size());
 }
 
+void SearchServer::SelectTopDocuments(std::vector<Document>& documents, size_t count) {
+	SEARCH_METRIC_TIMER(SELECT_TOP);
+	if (documents.size() <= count) {
+		std::sort(documents.begin(), documents.end(), DocumentRelevanceGreater());
+		return;
+	}
+	// куча из count лучших документов, в вершине — наименее релевантный из них
+	const auto heap_end = documents.begin() + count;
+	std::make_heap(documents.begin(), heap_end, DocumentRelevanceGreater());
+	for (auto it = heap_end; it != documents.end(); ++it) {
+		if (count > 0 && DocumentRelevanceGreater()(*it, documents.front())) {
+			std::pop_heap(documents.begin(), heap_end, DocumentRelevanceGreater());
+			*(heap_end - 1) = *it;
+			std::push_heap(documents.begin(), heap_end, DocumentRelevanceGreater());
+		}
+	}
+	std::sort_heap(documents.begin(), heap_end, DocumentRelevanceGreater());
+	documents.resize(count);
+}
+
 SearchServer::QueryWord SearchServer::ParseQueryWord(const std::string_view text) const {
 	if (text.empty()) {
 		throw std::invalid_argument("Query word is empty"s);
 	}
 	std::string word = std::string(text);
 	bool is_minus = false;
+	bool is_required = false;
 	if (word[0] == '-') {
 		is_minus = true;
 		word = word.substr(1);
+	} else if (word[0] == '+') {
+		is_required = true;
+		word = word.substr(1);
+	}
+	bool is_prefix = false;
+	if (!word.empty() && word.back() == '*') {
+		is_prefix = true;
+		word.pop_back();
 	}
-	if (word.empty() || word[0] == '-' || !IsValidWord(word)) {
-		throw std::invalid_argument("Query word "s + word + " is invalid"s);
+	if (word.empty() || word[0] == '-' || word[0] == '+' || (is_required && is_prefix) || !IsValidWord(word)) {
+		throw std::invalid_argument("Query word "s + std::string(text) + " is invalid"s);
 	}
-	return {word, is_minus, IsStopWord(word)};
+	return {word, is_minus, !is_prefix && IsStopWord(word), is_prefix, is_required};
 }
 
-SearchServer::Query SearchServer::ParseQuery(const std::string_view text) const {
+SearchServer::Query SearchServer::ParseQuery(const std::string_view text, const TermStatistics* statistics) const {
+	SEARCH_METRIC_TIMER(PARSE_QUERY);
 	Query result;
-	for (auto& word : SplitIntoWords(text)) {
-		const auto query_word = ParseQueryWord(word);
-		if (!query_word.is_stop) {
+	const auto words = SplitIntoWords(text);
+	for (size_t i = 0; i < words.size(); ++i) {
+		if (!words[i].empty() && words[i][0] == '"') {
+			i = ParseQueryPhrase(words, i, result);
+			continue;
+		}
+		const auto query_word = ParseQueryWord(words[i]);
+		if (query_word.is_prefix && query_word.is_minus) {
+			// минус-префикс исключает все подходящие слова, плюс-префикс — только самые частые
+			for (const PrefixCandidate& candidate : *GetPrefixCandidates(query_word.data)) {
+				result.minus_words.emplace(candidate.word);
+			}
+		} else if (query_word.is_prefix) {
+			QueryPrefix prefix{query_word.data, SelectPrefixWords(query_word.data, statistics)};
+			result.plus_words.insert(prefix.words.begin(), prefix.words.end());
+			result.plus_prefixes.push_back(std::move(prefix));
+		} else if (!query_word.is_stop) {
 			if (query_word.is_minus) {
 				result.minus_words.insert(query_word.data);
 			} else {
 				result.plus_words.insert(query_word.data);
 			}
+			if (query_word.is_required) {
+				result.required_words.insert(query_word.data);
+			}
 		}
 	}
 	return result;
 }
 
-double SearchServer::ComputeWordInverseDocumentFreq(const std::string& word) const {
-	return log(GetDocumentCount() * 1.0 / word_to_document_freqs_.at(word).size());
+const PostingList* SearchServer::FindPostings(const std::string_view word) const {
+	const auto it = word_to_document_freqs_.find(word);
+	return it == word_to_document_freqs_.end() ? nullptr : &it->second;
+}
+
+size_t SearchServer::ParseQueryPhrase(const std::vector<std::string_view>& words, size_t begin, Query& query) const {
+	QueryPhrase phrase;
+	size_t end = begin;
+	for (uint32_t offset = 0;; ++end, ++offset) {
+		if (end == words.size()) {
+			throw std::invalid_argument("Query phrase is not closed"s);
+		}
+		std::string_view word = words[end];
+		if (end == begin) {
+			word.remove_prefix(1);
+		}
+		const bool is_last = !word.empty() && word.back() == '"';
+		if (is_last) {
+			word.remove_suffix(1);
+		}
+		const auto query_word = ParseQueryWord(word);
+		if (query_word.is_minus || query_word.is_prefix || query_word.is_required) {
+			throw std::invalid_argument("Query phrase word "s + std::string(word) + " is invalid"s);
+		}
+		if (!query_word.is_stop) {
+			query.plus_words.insert(query_word.data);
+			phrase.words.push_back(query_word.data);
+			phrase.offsets.push_back(offset);
+		}
+		if (is_last) {
+			break;
+		}
+	}
+	// фраза из одного значимого слова — обычное слово запроса
+	if (phrase.words.size() > 1) {
+		if (!options_.positions) {
+			throw std::logic_error("Phrase queries require IndexOptions::positions"s);
+		}
+		query.required_words.insert(phrase.words.begin(), phrase.words.end());
+		query.phrases.push_back(std::move(phrase));
+	}
+	return end;
+}
+
+bool SearchServer::MatchesPhrases(int document_id, const Query& query) const {
+	std::vector<uint32_t> starts;
+	std::vector<uint32_t> positions;
+	for (const QueryPhrase& phrase : query.phrases) {
+		// проверка идёт от самого редкого слова фразы: у него меньше всего позиций
+		std::vector<size_t> order(phrase.words.size());
+		std::vector<size_t> document_freqs(phrase.words.size());
+		for (size_t i = 0; i < phrase.words.size(); ++i) {
+			const PostingList* postings = FindPostings(phrase.words[i]);
+			if (postings == nullptr || !postings->count(document_id)) {
+				return false;
+			}
+			order[i] = i;
+			document_freqs[i] = postings->size();
+		}
+		std::sort(order.begin(), order.end(), [&document_freqs](size_t lhs, size_t rhs) {
+			return document_freqs[lhs] < document_freqs[rhs];
+		});
+		// starts — позиции, с которых фраза ещё может начинаться
+		FindPositions(phrase.words[order[0]])->Get(document_id, starts);
+		const uint32_t first_offset = phrase.offsets[order[0]];
+		starts.erase(std::remove_if(starts.begin(), starts.end(), [first_offset](uint32_t position) {
+			return position < first_offset;
+		}), starts.end());
+		for (uint32_t& position : starts) {
+			position -= first_offset;
+		}
+		for (size_t i = 1; i < order.size() && !starts.empty(); ++i) {
+			FindPositions(phrase.words[order[i]])->Get(document_id, positions);
+			const uint32_t offset = phrase.offsets[order[i]];
+			starts.erase(std::remove_if(starts.begin(), starts.end(), [&positions, offset](uint32_t start) {
+				return !std::binary_search(positions.begin(), positions.end(), start + offset);
+			}), starts.end());
+		}
+		if (starts.empty()) {
+			return false;
+		}
+	}
+	return true;
+}
+
+std::shared_ptr<const std::vector<SearchServer::PrefixCandidate>> SearchServer::GetPrefixCandidates(const std::string_view prefix) const {
+	const bool is_cached = prefix.size() <= MAX_CACHED_PREFIX_LENGTH;
+	if (is_cached) {
+		std::lock_guard guard(prefix_cache_->mutex);
+		const auto it = prefix_cache_->candidates.find(prefix);
+		if (it != prefix_cache_->candidates.end()) {
+			SEARCH_METRIC_ADD(PREFIX_CACHE_HITS, 1);
+			return it->second;
+		}
+		SEARCH_METRIC_ADD(PREFIX_CACHE_MISSES, 1);
+	}
+	std::vector<PrefixCandidate> candidates;
+	for (auto it = word_to_document_freqs_.lower_bound(prefix);
+		it != word_to_document_freqs_.end() && it->first.compare(0, prefix.size(), prefix) == 0; ++it) {
+		if (IsStopWord(it->first)) {
+			continue;
+		}
+		candidates.push_back({it->first, it->second.size()});
+	}
+	SortPrefixCandidates(candidates);
+	auto result = std::make_shared<const std::vector<PrefixCandidate>>(std::move(candidates));
+	if (is_cached) {
+		// тот же список мог появиться из другого потока, пока этот его строил
+		std::lock_guard guard(prefix_cache_->mutex);
+		prefix_cache_->candidates.emplace(prefix, result);
+	}
+	return result;
+}
+
+void SearchServer::SortPrefixCandidates(std::vector<PrefixCandidate>& candidates) {
+	std::sort(candidates.begin(), candidates.end(), [](const PrefixCandidate& lhs, const PrefixCandidate& rhs) {
+		return lhs.document_freq != rhs.document_freq ? lhs.document_freq > rhs.document_freq : lhs.word < rhs.word;
+	});
+}
+
+std::vector<std::string> SearchServer::SelectPrefixWords(const std::string_view prefix, const TermStatistics* statistics) const {
+	std::shared_ptr<const std::vector<PrefixCandidate>> candidates;
+	if (statistics != nullptr && statistics->prefix_words.count(prefix) > 0) {
+		const auto& global_words = statistics->prefix_words.find(prefix)->second;
+		std::vector<PrefixCandidate> global_candidates;
+		global_candidates.reserve(global_words.size());
+		for (const std::string& word : global_words) {
+			global_candidates.push_back({word, static_cast<size_t>(statistics->document_freqs.at(word))});
+		}
+		SortPrefixCandidates(global_candidates);
+		candidates = std::make_shared<const std::vector<PrefixCandidate>>(std::move(global_candidates));
+	} else {
+		candidates = GetPrefixCandidates(prefix);
+	}
+	std::vector<std::string> result;
+	const size_t count = std::min<size_t>(candidates->size(), MAX_PREFIX_EXPANSION_COUNT);
+	result.reserve(count);
+	for (size_t i = 0; i < count; ++i) {
+		result.emplace_back((*candidates)[i].word);
+	}
+	return result;
+}
+
+void SearchServer::ClearPrefixCache() {
+	std::lock_guard guard(prefix_cache_->mutex);
+	prefix_cache_->candidates.clear();
+}
+
+std::vector<std::vector<const std::string*>> SearchServer::GroupPrefixWords(const Query& query, std::set<std::string_view>& grouped_words) {
+	std::vector<std::vector<const std::string*>> result;
+	for (const QueryPrefix& prefix : query.plus_prefixes) {
+		std::vector<const std::string*> words;
+		for (const std::string& word : prefix.words) {
+			if (grouped_words.insert(word).second) {
+				words.push_back(&word);
+			}
+		}
+		if (!words.empty()) {
+			result.push_back(std::move(words));
+		}
+	}
+	return result;
+}
+
+const PositionList* SearchServer::FindPositions(const std::string_view word) const {
+	const auto it = word_positions_.find(word);
+	return it == word_positions_.end() ? nullptr : &it->second;
+}
+
+RankingStatistics SearchServer::GetRankingStatistics() const {
+	return RankingStatistics::FromTotals(GetDocumentCount(), total_document_length_);
 }
 
 void AddDocument(SearchServer& search_server, int document_id, const std::string& document, DocumentStatus status,
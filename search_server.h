@@ -9,88 +9,353 @@
 #include <string_view>
 #include <execution>
 #include <cmath>
+#include <type_traits>
+#include <future>
+#include <functional>
+#include <memory>
+#include <limits>
+#include <numeric>
+#include <mutex>
+#include <optional>
 #include "document.h"
+#include "paginator.h"
 #include "string_processing.h"
 #include "concurrent_map.h"
 #include "log_duration.h"
+#include "thread_pool.h"
+#include "search_metrics.h"
+#include "posting_list.h"
+#include "document_predicate.h"
+#include "stop_word_filter.h"
+#include "ranker.h"
 
 const int MAX_RESULT_DOCUMENT_COUNT = 5;
+// слово запроса "prefix*" заменяется не более чем этим числом самых частых слов индекса с таким началом
+const int MAX_PREFIX_EXPANSION_COUNT = 50;
+// слова с префиксами не длиннее этого запоминаются до изменения индекса: короткому префиксу
+// подходит большая часть словаря. На каждую длину приходится не больше одной копии словаря
+const size_t MAX_CACHED_PREFIX_LENGTH = 3;
+// отсечение MaxScore держит top_count лучших документов в куче и ищет в ней документ перебором;
+// запросы большего числа документов считаются без отсечения
+const size_t MAX_PRUNED_TOP_COUNT = 100;
 using namespace std::string_literals;
 
+struct IndexOptions {
+	// прямой индекс (документ -> слова) нужен для GetWordFrequencies и ускоряет RemoveDocument
+	bool forward_index = true;
+	// позиции слов для запросов с фразами в кавычках; без них такой запрос бросает std::logic_error
+	bool positions = false;
+
+	// только обратный индекс: минимум памяти, GetWordFrequencies недоступен
+	static IndexOptions Compact() {
+		IndexOptions result;
+		result.forward_index = false;
+		return result;
+	}
+};
+
 class SearchServer {
+	template <typename ExecutionPolicy>
+	using EnableIfExecutionPolicy = std::enable_if_t<std::is_execution_policy_v<std::decay_t<ExecutionPolicy>>>;
+
+	struct DocumentData {
+		int rating;
+		DocumentStatus status;
+		// число слов без стоп-слов, для средней длины в Bm25
+		uint32_t length;
+	};
+
 public:
-	
+	// обход идентификаторов документов по возрастанию
+	class DocumentIdIterator {
+	public:
+		using iterator_category = std::bidirectional_iterator_tag;
+		using value_type = int;
+		using difference_type = std::ptrdiff_t;
+		using pointer = const int*;
+		using reference = const int&;
+
+		explicit DocumentIdIterator(std::map<int, DocumentData>::const_iterator it) : it_(it) {
+		}
+
+		const int& operator*() const {
+			return it_->first;
+		}
+
+		DocumentIdIterator& operator++() {
+			++it_;
+			return *this;
+		}
+
+		DocumentIdIterator& operator--() {
+			--it_;
+			return *this;
+		}
+
+		bool operator==(const DocumentIdIterator& other) const {
+			return it_ == other.it_;
+		}
+
+		bool operator!=(const DocumentIdIterator& other) const {
+			return it_ != other.it_;
+		}
+
+	private:
+		std::map<int, DocumentData>::const_iterator it_;
+	};
+
 	template <typename StringContainer>
-	explicit SearchServer(const StringContainer& stop_words);
-	explicit SearchServer(const std::string& stop_words_text);
-	explicit SearchServer(const std::string_view stop_words_text);
+	explicit SearchServer(const StringContainer& stop_words, const IndexOptions& options = IndexOptions());
+	explicit SearchServer(const std::string& stop_words_text, const IndexOptions& options = IndexOptions());
+	explicit SearchServer(const std::string_view stop_words_text, const IndexOptions& options = IndexOptions());
+	// прямой индекс хранит string_view на ключи обратного, поэтому при копировании он перестраивается
+	SearchServer(const SearchServer& other);
+	// перемещаемый сервер сначала дожидается задач своего пула: они держат указатель на него
+	SearchServer(SearchServer&& other);
 
 	void AddDocument(int document_id, const std::string_view& document, DocumentStatus status, const std::vector<int>& ratings);
+	// AddDocument в два шага: разбор на слова без стоп-слов не меняет индекс и может идти
+	// параллельно с добавлением других документов; слова — string_view на текст документа.
+	// positions получает номера слов в документе с учётом стоп-слов, они нужны при IndexOptions::positions
+	std::vector<std::string_view> TokenizeDocument(const std::string_view document, std::vector<uint32_t>* positions = nullptr) const;
+	void AddTokenizedDocument(int document_id, const std::vector<std::string_view>& words, DocumentStatus status, const std::vector<int>& ratings,
+		const std::vector<uint32_t>& positions = {});
+	const IndexOptions& GetIndexOptions() const;
 
-	template <typename DocumentPredicate>
+	// слова документа, сгруппированные по слову: индекс обновляется один раз на слово,
+	// а не на каждое вхождение. Группировку можно делать вне потока, меняющего индекс
+	struct TokenizedDocument {
+		struct Term {
+			std::string_view word;
+			uint32_t count = 0;
+		};
+		// по возрастанию слов
+		std::vector<Term> terms;
+		// позиции вхождений подряд для каждого слова в порядке terms; пусто без позиций
+		std::vector<uint32_t> positions;
+		uint32_t length = 0;
+	};
+	static TokenizedDocument GroupDocumentWords(const std::vector<std::string_view>& words, const std::vector<uint32_t>& positions = {});
+	void AddTokenizedDocument(int document_id, const TokenizedDocument& document, DocumentStatus status, const std::vector<int>& ratings);
+
+	// стоп-слова меняются без перестройки индекса. Новое стоп-слово сразу исчезает из запросов,
+	// а его вхождения удаляются позже, в PurgeStopWords или ShrinkToFit; до этого оно остаётся
+	// в GetWordFrequencies. Удалённое стоп-слово индексируется только в новых документах
+	void AddStopWord(const std::string_view word);
+	void RemoveStopWord(const std::string_view word);
+	void PurgeStopWords();
+
+	// Ranker — функция ранжирования из ranker.h: FindTopDocuments<Bm25>(raw_query), по умолчанию TfIdf
+	template <typename Ranker = TfIdf, typename DocumentPredicate>
 	std::vector<Document> FindTopDocuments(const std::string_view raw_query, DocumentPredicate document_predicate) const;
+	template <typename Ranker>
+	std::vector<Document> FindTopDocuments(const std::string_view raw_query, DocumentStatus status) const;
+	template <typename Ranker>
+	std::vector<Document> FindTopDocuments(const std::string_view raw_query) const;
 	std::vector<Document> FindTopDocuments(const std::string_view raw_query, DocumentStatus status) const;
 	std::vector<Document> FindTopDocuments(const std::string_view raw_query) const; 
 
-	template <typename DocumentPredicate, typename ExecutionPolicy>
+	template <typename Ranker = TfIdf, typename DocumentPredicate, typename ExecutionPolicy, typename = EnableIfExecutionPolicy<ExecutionPolicy>>
 	std::vector<Document> FindTopDocuments(ExecutionPolicy&& policy, const std::string_view raw_query, DocumentPredicate document_predicate) const;
-	template <typename ExecutionPolicy>
+	template <typename Ranker = TfIdf, typename ExecutionPolicy, typename = EnableIfExecutionPolicy<ExecutionPolicy>>
 	std::vector<Document> FindTopDocuments(ExecutionPolicy&& policy, const std::string_view raw_query, DocumentStatus status) const;
-	template <typename ExecutionPolicy>
+	template <typename Ranker = TfIdf, typename ExecutionPolicy, typename = EnableIfExecutionPolicy<ExecutionPolicy>>
 	std::vector<Document> FindTopDocuments(ExecutionPolicy&& policy, const std::string_view raw_query) const;
 
+	// страница page (с нуля) выдачи; отбираются только первые (page + 1) * page_size документов
+	template <typename Ranker = TfIdf, typename DocumentPredicate>
+	std::vector<Document> FindTopDocuments(const std::string_view raw_query, DocumentPredicate document_predicate, size_t page, size_t page_size) const;
+	template <typename Ranker>
+	std::vector<Document> FindTopDocuments(const std::string_view raw_query, size_t page, size_t page_size) const;
+	std::vector<Document> FindTopDocuments(const std::string_view raw_query, size_t page, size_t page_size) const;
+
+	using DocumentCursor = PageCursor<Document, DocumentRelevanceGreater>;
+	template <typename Ranker = TfIdf, typename DocumentPredicate>
+	DocumentCursor FindDocumentPages(const std::string_view raw_query, size_t page_size, DocumentPredicate document_predicate) const;
+	template <typename Ranker>
+	DocumentCursor FindDocumentPages(const std::string_view raw_query, size_t page_size) const;
+	DocumentCursor FindDocumentPages(const std::string_view raw_query, size_t page_size) const;
+
+	// частоты слов запроса и длины документов для ранжирования по нескольким индексам (шардам)
+	struct TermStatistics {
+		int document_count = 0;
+		// сумма длин документов: средняя длина для Bm25
+		uint64_t total_document_length = 0;
+		std::map<std::string, int, std::less<>> document_freqs;
+		// все слова индекса для каждого префикса "prefix*" запроса, по алфавиту; их частоты — в document_freqs.
+		// По ним FindTopDocuments с общей статистикой выбирает одни и те же слова во всех шардах
+		std::map<std::string, std::vector<std::string>, std::less<>> prefix_words;
+
+		void Merge(const TermStatistics& other);
+	};
+	TermStatistics GetTermStatistics(const std::string_view raw_query) const;
+	template <typename Ranker = TfIdf, typename DocumentPredicate>
+	std::vector<Document> FindTopDocuments(const std::string_view raw_query, const TermStatistics& global_statistics, DocumentPredicate document_predicate) const;
+
+	// асинхронные запросы выполняются в собственном пуле сервера, его нужно настроить заранее.
+	// Задачи пула ссылаются на сервер, поэтому копия сервера получает свой пул с теми же настройками
+	void ConfigureExecutor(const ThreadPool::Options& options);
+	template <typename DocumentPredicate>
+	std::future<std::vector<Document>> FindTopDocumentsAsync(std::string raw_query, DocumentPredicate document_predicate) const;
+	std::future<std::vector<Document>> FindTopDocumentsAsync(std::string raw_query, DocumentStatus status) const;
+	std::future<std::vector<Document>> FindTopDocumentsAsync(std::string raw_query) const;
+	// не блокируется: при заполненной очереди пула возвращает false и callback не вызывается
+	using SearchCallback = std::function<void(std::vector<Document>, std::exception_ptr)>;
+	bool TrySubmitFindTopDocuments(std::string raw_query, SearchCallback callback) const;
+
 	using WordsInDocument = std::tuple<std::vector<std::string_view>, DocumentStatus>;
 	WordsInDocument MatchDocument(const std::string_view raw_query, int document_id) const;
 	WordsInDocument MatchDocument(std::execution::parallel_policy, const std::string_view raw_query, int document_id) const;
 	WordsInDocument MatchDocument(std::execution::sequenced_policy, const std::string_view raw_query, int document_id) const;
 
 	int GetDocumentCount() const;
-	std::set<int>::const_iterator begin() const;
-	std::set<int>::const_iterator end() const;
+	DocumentIdIterator begin() const;
+	DocumentIdIterator end() const;
+	// требует прямого индекса, иначе бросает std::logic_error
 	const std::map<std::string_view, double>& GetWordFrequencies(int document_id) const;
 
 	void RemoveDocument(int document_id);
 	template <typename ExecutionPolicy>
 	void RemoveDocument(ExecutionPolicy&& policy, int document_id);
 
-private:
-	struct DocumentData {
-		int rating;
-		DocumentStatus status;
+	// оценка занимаемой памяти в байтах по структурам
+	struct MemoryUsage {
+		size_t stop_words = 0;
+		size_t term_dictionary = 0;
+		size_t postings = 0;
+		size_t forward_index = 0;
+		size_t positions = 0;
+		size_t documents = 0;
+
+		size_t GetTotal() const;
+	};
+	MemoryUsage GetMemoryUsage() const;
+	// освобождает запас ёмкости списков вхождений, например после массовой загрузки,
+	// и удаляет вхождения стоп-слов
+	void ShrinkToFit();
+
+	// двоичный снимок индекса для перезагрузки без повторной индексации; пул потоков не сохраняется.
+	// Формат зависит от порядка байт платформы. Повреждённый снимок — std::runtime_error
+	void SaveSnapshot(std::ostream& out) const;
+	static SearchServer LoadSnapshot(std::istream& in);
+
+	struct IndexGauges {
+		size_t documents = 0;
+		size_t terms = 0;
+		size_t postings = 0;
+		MemoryUsage memory;
 	};
-	const std::set<std::string> stop_words_;
-	std::map<std::string, std::map<int, double>> word_to_document_freqs_;
+	IndexGauges GetIndexGauges() const;
+	// только размеры индекса этого сервера; метрики запросов общие для процесса, их даёт CollectMetrics
+	void ExportIndexGauges(std::ostream& out, MetricsFormat format) const;
+
+private:
+	const IndexOptions options_;
+	StopWordFilter stop_words_;
+	std::map<std::string, PostingList, std::less<>> word_to_document_freqs_;
 	std::map<int, DocumentData> documents_;
-	std::map<int, std::map<std::string,double>>  id_freqs_word_;
-	std::set<int> document_ids_;
+	std::map<int, std::map<std::string_view, double>> id_freqs_word_;
+	// ключи — string_view на ключи word_to_document_freqs_
+	std::map<std::string_view, PositionList> word_positions_;
+	// сумма длин документов для средней длины в Bm25
+	uint64_t total_document_length_ = 0;
+
+	struct PrefixCandidate {
+		std::string_view word;
+		size_t document_freq;
+	};
+	// слова кэша — string_view на ключи word_to_document_freqs_, поэтому кэш очищается при любом
+	// изменении индекса или стоп-слов. Копия сервера начинает с пустого кэша
+	struct PrefixCache {
+		std::mutex mutex;
+		std::map<std::string, std::shared_ptr<const std::vector<PrefixCandidate>>, std::less<>> candidates;
+	};
+	std::unique_ptr<PrefixCache> prefix_cache_ = std::make_unique<PrefixCache>();
+	// последний член: пул останавливается и дожидается задач раньше, чем разрушается индекс
+	std::unique_ptr<ThreadPool> executor_;
 
 	bool IsStopWord(const std::string_view word) const;
 	static bool IsValidWord(const std::string_view word);
-	std::vector<std::string> SplitIntoWordsNoStop(const std::string_view text) const;
+	void PurgeTerm(std::map<std::string, PostingList, std::less<>>::iterator term);
 
 	struct QueryWord {
 		std::string data;
 		bool is_minus;
 		bool is_stop;
+		bool is_prefix;
+		bool is_required;
+	};
+
+	// "слова в кавычках": offsets — места слов во фразе с учётом пропущенных стоп-слов
+	struct QueryPhrase {
+		std::vector<std::string> words;
+		std::vector<uint32_t> offsets;
+	};
+
+	// слова, на которые раскрылся "prefix*"; они входят и в plus_words
+	struct QueryPrefix {
+		std::string prefix;
+		std::vector<std::string> words;
 	};
 
 	struct Query {
 		std::set<std::string, std::less<>> plus_words;
 		std::set<std::string, std::less<>> minus_words;
+		// "+слово" и слова фраз: документ должен содержать их все; они входят и в plus_words
+		std::set<std::string, std::less<>> required_words;
+		std::vector<QueryPhrase> phrases;
+		std::vector<QueryPrefix> plus_prefixes;
 	};
 
-	Query ParseQuery(const std::string_view text) const;
+	// statistics задаёт слова префиксов вместо локальных самых частых, см. TermStatistics::prefix_words
+	Query ParseQuery(const std::string_view text, const TermStatistics* statistics = nullptr) const;
 	QueryWord ParseQueryWord(const std::string_view text) const;
+	// разбирает фразу, начинающуюся с words[begin]; возвращает индекс её последнего слова
+	size_t ParseQueryPhrase(const std::vector<std::string_view>& words, size_t begin, Query& query) const;
+	bool MatchesPhrases(int document_id, const Query& query) const;
+	// слова индекса, начинающиеся с prefix, от самых частых; при равной частоте — по алфавиту
+	std::shared_ptr<const std::vector<PrefixCandidate>> GetPrefixCandidates(const std::string_view prefix) const;
+	static void SortPrefixCandidates(std::vector<PrefixCandidate>& candidates);
+	std::vector<std::string> SelectPrefixWords(const std::string_view prefix, const TermStatistics* statistics) const;
+	void ClearPrefixCache();
 
+	const PostingList* FindPostings(const std::string_view word) const;
+	const PositionList* FindPositions(const std::string_view word) const;
+	template <typename Ranker>
 	double ComputeWordInverseDocumentFreq(const std::string& word) const;
+	RankingStatistics GetRankingStatistics() const;
 	static int ComputeAverageRating(const std::vector<int>& ratings);
+	static void SelectTopDocuments(std::vector<Document>& documents, size_t count);
+	ThreadPool& GetExecutor() const;
 	
+	// top_count — сколько лучших документов нужно вызывающему: документы, которые заведомо
+	// в них не попадут, могут отсутствовать в результате
+	template <typename Ranker, typename DocumentPredicate>
+	std::vector<Document> FindAllDocuments(const Query& query, DocumentPredicate document_predicate, size_t top_count = ALL_DOCUMENTS) const;
+	template <typename Ranker, typename DocumentPredicate, typename InverseDocumentFreq>
+	std::vector<Document> FindAllDocuments(const Query& query, DocumentPredicate document_predicate, const RankingStatistics& statistics,
+		InverseDocumentFreq inverse_document_freq, size_t top_count) const;
+	// вклады слов одного префикса, сложенные по документам за один проход слиянием их списков вхождений,
+	// по возрастанию id
+	template <typename Ranker, typename InverseDocumentFreq>
+	std::vector<std::pair<int, double>> ScorePrefixWords(const std::vector<const std::string*>& words, const RankingStatistics& statistics,
+		InverseDocumentFreq inverse_document_freq) const;
+	// слова префиксов запроса, ещё не попавшие в предыдущие префиксы; слово оценивается один раз
+	static std::vector<std::vector<const std::string*>> GroupPrefixWords(const Query& query, std::set<std::string_view>& grouped_words);
+	// поиск при наличии обязательных слов: пересечение их списков от самого короткого
+	template <typename Ranker, typename DocumentPredicate, typename InverseDocumentFreq>
+	std::vector<Document> FindRequiredDocuments(const Query& query, DocumentPredicate document_predicate, const RankingStatistics& statistics,
+		InverseDocumentFreq inverse_document_freq) const;
+	template <typename Ranker, typename DocumentPredicate>
+	std::vector<Document> FindAllDocuments(std::execution::parallel_policy, const Query& query, DocumentPredicate document_predicate, size_t top_count) const;
+	template <typename Ranker, typename DocumentPredicate>
+	std::vector<Document> FindAllDocuments(std::execution::sequenced_policy, const Query& query, DocumentPredicate document_predicate, size_t top_count) const;
+	// предикаты-фильтры из document_predicate.h проверяются здесь, один раз на документ,
+	// и фразы запроса
 	template <typename DocumentPredicate>
-	std::vector<Document> FindAllDocuments(const Query& query, DocumentPredicate document_predicate) const;
-	template <typename DocumentPredicate>
-	std::vector<Document> FindAllDocuments(std::execution::parallel_policy, const Query& query, DocumentPredicate document_predicate) const;
-	template <typename DocumentPredicate>
-	std::vector<Document> FindAllDocuments(std::execution::sequenced_policy, const Query& query, DocumentPredicate document_predicate) const;
+	std::vector<Document> BuildMatchedDocuments(const Query& query, const std::map<int, double>& document_to_relevance, DocumentPredicate document_predicate) const;
+
+	static constexpr size_t ALL_DOCUMENTS = std::numeric_limits<size_t>::max();
 };
 
 void AddDocument(SearchServer& search_server, int document_id, const std::string& document, DocumentStatus status, const std::vector<int>& ratings);
@@ -98,166 +363,477 @@ void FindTopDocuments(const SearchServer& search_server, const std::string& raw_
 void MatchDocuments(const SearchServer& search_server, const std::string& query);
 
 template <typename StringContainer>
-SearchServer::SearchServer(const StringContainer& stop_words)
-: stop_words_(MakeUniqueNonEmptyStrings(stop_words)){
-	if (!all_of(stop_words_.begin(), stop_words_.end(), IsValidWord)) {
+SearchServer::SearchServer(const StringContainer& stop_words, const IndexOptions& options)
+: options_(options)
+, stop_words_(MakeUniqueNonEmptyStrings(stop_words)){
+	const auto words = stop_words_.GetWords();
+	if (!all_of(words.begin(), words.end(), IsValidWord)) {
 		throw std::invalid_argument("Some of stop words are invalid"s);
 	}
 }
 
-template <typename DocumentPredicate>
+template <typename Ranker, typename DocumentPredicate>
 std::vector<Document> SearchServer::FindTopDocuments(const std::string_view raw_query, DocumentPredicate document_predicate) const {
 	const auto query = ParseQuery(raw_query);
-	auto matched_documents = FindAllDocuments(query, document_predicate);
-	std::sort(matched_documents.begin(), matched_documents.end(), [](const Document& lhs, const Document& rhs) {
-		if (std::abs(lhs.relevance - rhs.relevance) < 1e-6) {
-			return lhs.rating > rhs.rating;
-		} else {
-			return lhs.relevance > rhs.relevance;
-		}
-	});
-	if (matched_documents.size() > MAX_RESULT_DOCUMENT_COUNT) {
-		matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
-	}
+	auto matched_documents = FindAllDocuments<Ranker>(query, document_predicate, MAX_RESULT_DOCUMENT_COUNT);
+	SelectTopDocuments(matched_documents, MAX_RESULT_DOCUMENT_COUNT);
 	return matched_documents;
 }
 
-template <typename DocumentPredicate, typename ExecutionPolicy>
+template <typename Ranker>
+std::vector<Document> SearchServer::FindTopDocuments(const std::string_view raw_query, DocumentStatus status) const {
+	return VisitStatusPredicate(status, [&](auto document_predicate) {
+		return FindTopDocuments<Ranker>(raw_query, document_predicate);
+	});
+}
+
+template <typename Ranker>
+std::vector<Document> SearchServer::FindTopDocuments(const std::string_view raw_query) const {
+	return FindTopDocuments<Ranker>(raw_query, ByStatus<DocumentStatus::ACTUAL>());
+}
+
+template <typename Ranker, typename DocumentPredicate, typename ExecutionPolicy, typename>
 std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy&& policy, const std::string_view raw_query, DocumentPredicate document_predicate) const {
 	const auto query = ParseQuery(raw_query);
-	auto matched_documents = FindAllDocuments(policy, query, document_predicate);
-	std::sort(policy, matched_documents.begin(), matched_documents.end(), [](const Document& lhs, const Document& rhs) {
-		if (std::abs(lhs.relevance - rhs.relevance) < 1e-6) {
-			return lhs.rating > rhs.rating;
-			} else {
-			return lhs.relevance > rhs.relevance;
-		}
-	});
-	if (matched_documents.size() > MAX_RESULT_DOCUMENT_COUNT) {
-		matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
-	}
+	auto matched_documents = FindAllDocuments<Ranker>(policy, query, document_predicate, MAX_RESULT_DOCUMENT_COUNT);
+	SelectTopDocuments(matched_documents, MAX_RESULT_DOCUMENT_COUNT);
 	return matched_documents;
 }
 
-template <typename ExecutionPolicy>
+template <typename Ranker, typename DocumentPredicate>
+std::vector<Document> SearchServer::FindTopDocuments(const std::string_view raw_query, DocumentPredicate document_predicate, size_t page, size_t page_size) const {
+	const auto query = ParseQuery(raw_query);
+	auto matched_documents = FindAllDocuments<Ranker>(query, document_predicate, (page + 1) * page_size);
+	const size_t page_begin = std::min(page * page_size, matched_documents.size());
+	SelectTopDocuments(matched_documents, page_begin + page_size);
+	matched_documents.erase(matched_documents.begin(), matched_documents.begin() + page_begin);
+	return matched_documents;
+}
+
+template <typename Ranker>
+std::vector<Document> SearchServer::FindTopDocuments(const std::string_view raw_query, size_t page, size_t page_size) const {
+	return FindTopDocuments<Ranker>(raw_query, ByStatus<DocumentStatus::ACTUAL>(), page, page_size);
+}
+
+template <typename Ranker, typename DocumentPredicate>
+SearchServer::DocumentCursor SearchServer::FindDocumentPages(const std::string_view raw_query, size_t page_size, DocumentPredicate document_predicate) const {
+	const auto query = ParseQuery(raw_query);
+	return DocumentCursor(FindAllDocuments<Ranker>(query, document_predicate), page_size);
+}
+
+template <typename Ranker>
+SearchServer::DocumentCursor SearchServer::FindDocumentPages(const std::string_view raw_query, size_t page_size) const {
+	return FindDocumentPages<Ranker>(raw_query, page_size, ByStatus<DocumentStatus::ACTUAL>());
+}
+
+template <typename Ranker, typename DocumentPredicate>
+std::vector<Document> SearchServer::FindTopDocuments(const std::string_view raw_query, const TermStatistics& global_statistics, DocumentPredicate document_predicate) const {
+	const auto query = ParseQuery(raw_query, &global_statistics);
+	const auto statistics = RankingStatistics::FromTotals(global_statistics.document_count, global_statistics.total_document_length);
+	auto matched_documents = FindAllDocuments<Ranker>(query, document_predicate, statistics, [&global_statistics](const std::string& word) {
+		return Ranker::ComputeInverseDocumentFreq(global_statistics.document_count, global_statistics.document_freqs.at(word));
+	}, MAX_RESULT_DOCUMENT_COUNT);
+	SelectTopDocuments(matched_documents, MAX_RESULT_DOCUMENT_COUNT);
+	return matched_documents;
+}
+
+template <typename DocumentPredicate>
+std::future<std::vector<Document>> SearchServer::FindTopDocumentsAsync(std::string raw_query, DocumentPredicate document_predicate) const {
+	auto task = std::make_shared<std::packaged_task<std::vector<Document>()>>(
+		[this, raw_query = std::move(raw_query), document_predicate] {
+			return FindTopDocuments(raw_query, document_predicate);
+		});
+	auto result = task->get_future();
+	GetExecutor().Submit([task] {
+		(*task)();
+	});
+	return result;
+}
+
+template <typename Ranker, typename ExecutionPolicy, typename>
 std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy&& policy, const std::string_view raw_query, DocumentStatus status) const {
-	return FindTopDocuments(policy, raw_query, [status](int, DocumentStatus document_status, int) {
-		return document_status == status;
+	return VisitStatusPredicate(status, [&](auto document_predicate) {
+		return FindTopDocuments<Ranker>(policy, raw_query, document_predicate);
 	});
 }
-template <typename ExecutionPolicy>	
-	std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy&& policy, const std::string_view raw_query) const {
-	return FindTopDocuments(policy, raw_query, DocumentStatus::ACTUAL);
+template <typename Ranker, typename ExecutionPolicy, typename>
+std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy&& policy, const std::string_view raw_query) const {
+	return FindTopDocuments<Ranker>(policy, raw_query, ByStatus<DocumentStatus::ACTUAL>());
 }
 
-template <typename DocumentPredicate>
-std::vector<Document> SearchServer::FindAllDocuments(const Query& query, DocumentPredicate document_predicate) const {
-	std::map<int, double> document_to_relevance;
+template <typename Ranker>
+double SearchServer::ComputeWordInverseDocumentFreq(const std::string& word) const {
+	return Ranker::ComputeInverseDocumentFreq(GetDocumentCount(), word_to_document_freqs_.at(word).size());
+}
+
+template <typename Ranker, typename DocumentPredicate>
+std::vector<Document> SearchServer::FindAllDocuments(const Query& query, DocumentPredicate document_predicate, size_t top_count) const {
+	return FindAllDocuments<Ranker>(query, document_predicate, GetRankingStatistics(), [this](const std::string& word) {
+		return ComputeWordInverseDocumentFreq<Ranker>(word);
+	}, top_count);
+}
+
+template <typename Ranker, typename DocumentPredicate, typename InverseDocumentFreq>
+std::vector<Document> SearchServer::FindAllDocuments(const Query& query, DocumentPredicate document_predicate, const RankingStatistics& statistics,
+	InverseDocumentFreq inverse_document_freq, size_t top_count) const {
+	SEARCH_METRIC_ADD(QUERIES, 1);
+	if (!query.required_words.empty()) {
+		return FindRequiredDocuments<Ranker>(query, document_predicate, statistics, inverse_document_freq);
+	}
+	// слово запроса или все слова одного префикса: их вклады складываются за один проход
+	// слиянием списков, а не отдельным проходом по map на слово
+	struct ScoredTerm {
+		const PostingList* postings;
+		std::optional<typename Ranker::TermScorer> scorer;
+		std::vector<std::pair<int, double>> prefix_scores;
+		double upper_bound;
+	};
+	std::vector<ScoredTerm> terms;
+	std::set<std::string_view> grouped_words;
+	for (const auto& words : GroupPrefixWords(query, grouped_words)) {
+		auto prefix_scores = ScorePrefixWords<Ranker>(words, statistics, inverse_document_freq);
+		double upper_bound = 0.0;
+		for (const auto& [_, relevance] : prefix_scores) {
+			upper_bound = std::max(upper_bound, relevance);
+		}
+		terms.push_back({nullptr, std::nullopt, std::move(prefix_scores), upper_bound});
+	}
 	for (const std::string& word : query.plus_words) {
-		if (word_to_document_freqs_.count(word) == 0) {
-			continue;
+		const PostingList* postings = FindPostings(word);
+		if (postings != nullptr && grouped_words.count(word) == 0) {
+			const typename Ranker::TermScorer scorer(inverse_document_freq(word), statistics);
+			terms.push_back({postings, scorer, {}, scorer.GetUpperBound(postings->GetBounds())});
+		}
+	}
+	// MaxScore: слова идут по убыванию оценки сверху. Когда сумма оценок оставшихся слов меньше
+	// релевантности top_count-го документа, новый документ в первые top_count уже не попадёт,
+	// и оставшиеся слова только уточняют релевантность найденных. Минус-слова и фразы могут
+	// исключить найденные документы, с ними отсечение не применяется
+	std::sort(terms.begin(), terms.end(), [](const ScoredTerm& lhs, const ScoredTerm& rhs) {
+		return lhs.upper_bound > rhs.upper_bound;
+	});
+	std::vector<double> remaining_bounds(terms.size() + 1, 0.0);
+	for (size_t i = terms.size(); i > 0; --i) {
+		remaining_bounds[i - 1] = remaining_bounds[i] + terms[i - 1].upper_bound;
+	}
+	const bool can_prune = top_count > 0 && top_count <= MAX_PRUNED_TOP_COUNT && query.minus_words.empty() && query.phrases.empty();
+	// top_count наибольших релевантностей подходящих документов, по одной на документ; в вершине —
+	// наименьшая, это и есть порог. Релевантности только растут, поэтому документ с прежней
+	// релевантностью ниже вершины в куче отсутствует, и искать его там не нужно
+	std::vector<std::pair<double, int>> top_documents;
+	top_documents.reserve(can_prune ? top_count : 0);
+	const auto UpdateTopDocuments = [&](int document_id, bool is_new, double old_relevance, double relevance) {
+		const bool is_full = top_documents.size() == top_count;
+		if (is_full && relevance <= top_documents.front().first) {
+			return;
+		}
+		if (!is_new && !(is_full && old_relevance < top_documents.front().first)) {
+			const auto it = std::find_if(top_documents.begin(), top_documents.end(), [document_id](const std::pair<double, int>& entry) {
+				return entry.second == document_id;
+			});
+			if (it != top_documents.end()) {
+				it->first = relevance;
+				std::make_heap(top_documents.begin(), top_documents.end(), std::greater<>());
+				return;
+			}
 		}
-		const double inverse_document_freq = ComputeWordInverseDocumentFreq(word);
-		for (const auto [document_id, term_freq] : word_to_document_freqs_.at(word)) {
+		if constexpr (DocumentPredicateTraits<DocumentPredicate>::is_document_filter && !DocumentPredicateTraits<DocumentPredicate>::accepts_all) {
 			const auto& document_data = documents_.at(document_id);
-			if (document_predicate(document_id, document_data.status, document_data.rating)) {
-				document_to_relevance[document_id] += term_freq * inverse_document_freq;
-			}	
+			if (!document_predicate(document_id, document_data.status, document_data.rating)) {
+				return;
+			}
+		}
+		if (is_full) {
+			std::pop_heap(top_documents.begin(), top_documents.end(), std::greater<>());
+			top_documents.back() = {relevance, document_id};
+		} else {
+			top_documents.emplace_back(relevance, document_id);
+		}
+		std::push_heap(top_documents.begin(), top_documents.end(), std::greater<>());
+	};
+	bool adds_documents = true;
+	std::map<int, double> document_to_relevance;
+	const auto AddRelevance = [&](int document_id, double relevance) {
+		if (!adds_documents) {
+			const auto it = document_to_relevance.find(document_id);
+			if (it != document_to_relevance.end()) {
+				it->second += relevance;
+			}
+			return;
+		}
+		if constexpr (!DocumentPredicateTraits<DocumentPredicate>::is_document_filter) {
+			const auto& document_data = documents_.at(document_id);
+			if (!document_predicate(document_id, document_data.status, document_data.rating)) {
+				return;
+			}
+		}
+		const auto [it, is_new] = document_to_relevance.try_emplace(document_id, 0.0);
+		const double old_relevance = it->second;
+		it->second += relevance;
+		if (can_prune) {
+			UpdateTopDocuments(document_id, is_new, old_relevance, it->second);
+		}
+	};
+	for (size_t i = 0; i < terms.size(); ++i) {
+		const ScoredTerm& term = terms[i];
+		if (can_prune && adds_documents && top_documents.size() == top_count) {
+			adds_documents = remaining_bounds[i] >= top_documents.front().first - RELEVANCE_EPSILON;
+		}
+		if (term.postings == nullptr) {
+			for (const auto& [document_id, relevance] : term.prefix_scores) {
+				AddRelevance(document_id, relevance);
+			}
+			continue;
+		}
+		SEARCH_METRIC_ADD(POSTINGS_SCANNED, term.postings->size());
+		for (const PostingList::Posting& posting : *term.postings) {
+			AddRelevance(posting.document_id, (*term.scorer)(posting.term_freq, posting.document_length));
 		}
 	}
+	SEARCH_METRIC_ADD(DOCUMENTS_SCORED, document_to_relevance.size());
+	[[maybe_unused]] const size_t scored_count = document_to_relevance.size();
 	for (const std::string& word : query.minus_words) {
-		if (word_to_document_freqs_.count(word) == 0) {
+		const PostingList* postings = FindPostings(word);
+		if (postings == nullptr) {
 			continue;
 		}
-		for (const auto [document_id, _] : word_to_document_freqs_.at(word)) {
-			document_to_relevance.erase(document_id);
+		SEARCH_METRIC_ADD(POSTINGS_SCANNED, postings->size());
+		for (const PostingList::Posting& posting : *postings) {
+			document_to_relevance.erase(posting.document_id);
 		}
 	}
+	SEARCH_METRIC_ADD(MINUS_WORD_EXCLUSIONS, scored_count - document_to_relevance.size());
+	return BuildMatchedDocuments(query, document_to_relevance, document_predicate);
+}
+
+template <typename DocumentPredicate>
+std::vector<Document> SearchServer::BuildMatchedDocuments(const Query& query, const std::map<int, double>& document_to_relevance, DocumentPredicate document_predicate) const {
 	std::vector<Document> matched_documents;
+	matched_documents.reserve(document_to_relevance.size());
 	for (const auto [document_id, relevance] : document_to_relevance) {
-		matched_documents.push_back({document_id, relevance, documents_.at(document_id).rating});
+		const auto& document_data = documents_.at(document_id);
+		if constexpr (DocumentPredicateTraits<DocumentPredicate>::is_document_filter && !DocumentPredicateTraits<DocumentPredicate>::accepts_all) {
+			if (!document_predicate(document_id, document_data.status, document_data.rating)) {
+				continue;
+			}
+		}
+		if (!query.phrases.empty() && !MatchesPhrases(document_id, query)) {
+			continue;
+		}
+		matched_documents.push_back({document_id, relevance, document_data.rating});
 	}
 	return matched_documents;
 }
 
-template <typename DocumentPredicate>
-std::vector<Document> SearchServer::FindAllDocuments(std::execution::sequenced_policy, const Query& query, DocumentPredicate document_predicate) const {
-	std::map<int, double> document_to_relevance;
-	for (const std::string& word : query.plus_words) {
-		if (word_to_document_freqs_.count(word) == 0) {
+template <typename Ranker, typename InverseDocumentFreq>
+std::vector<std::pair<int, double>> SearchServer::ScorePrefixWords(const std::vector<const std::string*>& words, const RankingStatistics& statistics,
+	InverseDocumentFreq inverse_document_freq) const {
+	struct Cursor {
+		PostingList::ConstIterator it;
+		PostingList::ConstIterator end;
+		size_t term;
+	};
+	std::vector<typename Ranker::TermScorer> scorers;
+	std::vector<Cursor> cursors;
+	size_t max_size = 0;
+	for (const std::string* word : words) {
+		const PostingList* postings = FindPostings(*word);
+		if (postings == nullptr) {
 			continue;
 		}
-		const double inverse_document_freq = ComputeWordInverseDocumentFreq(word);
-		for (const auto [document_id, term_freq] : word_to_document_freqs_.at(word)) {
-			const auto& document_data = documents_.at(document_id);
-			if (document_predicate(document_id, document_data.status, document_data.rating)) {
-				document_to_relevance[document_id] += term_freq * inverse_document_freq;
-			}	
+		SEARCH_METRIC_ADD(POSTINGS_SCANNED, postings->size());
+		scorers.emplace_back(inverse_document_freq(*word), statistics);
+		cursors.push_back({postings->begin(), postings->end(), scorers.size() - 1});
+		max_size = std::max(max_size, postings->size());
+	}
+	// на вершине кучи — наименьший документ, при равенстве — слово с меньшим номером,
+	// так что вклады одного документа всегда складываются в одном порядке
+	const auto CursorGreater = [](const Cursor& lhs, const Cursor& rhs) {
+		return lhs.it->document_id != rhs.it->document_id ? lhs.it->document_id > rhs.it->document_id : lhs.term > rhs.term;
+	};
+	std::make_heap(cursors.begin(), cursors.end(), CursorGreater);
+	std::vector<std::pair<int, double>> result;
+	result.reserve(max_size);
+	while (!cursors.empty()) {
+		const int document_id = cursors.front().it->document_id;
+		double relevance = 0.0;
+		while (!cursors.empty() && cursors.front().it->document_id == document_id) {
+			std::pop_heap(cursors.begin(), cursors.end(), CursorGreater);
+			Cursor& cursor = cursors.back();
+			relevance += scorers[cursor.term](cursor.it->term_freq, cursor.it->document_length);
+			if (++cursor.it == cursor.end) {
+				cursors.pop_back();
+			} else {
+				std::push_heap(cursors.begin(), cursors.end(), CursorGreater);
+			}
+		}
+		result.emplace_back(document_id, relevance);
+	}
+	return result;
+}
+
+template <typename Ranker, typename DocumentPredicate, typename InverseDocumentFreq>
+std::vector<Document> SearchServer::FindRequiredDocuments(const Query& query, DocumentPredicate document_predicate, const RankingStatistics& statistics,
+	InverseDocumentFreq inverse_document_freq) const {
+	std::vector<const PostingList*> required_postings;
+	for (const std::string& word : query.required_words) {
+		const PostingList* postings = FindPostings(word);
+		if (postings == nullptr) {
+			return {};
 		}
+		required_postings.push_back(postings);
+	}
+	std::sort(required_postings.begin(), required_postings.end(), [](const PostingList* lhs, const PostingList* rhs) {
+		return lhs->size() < rhs->size();
+	});
+	// кандидаты — документы самого редкого слова; каждый следующий список только сужает их
+	std::vector<std::pair<int, double>> candidates;
+	candidates.reserve(required_postings.front()->size());
+	for (const PostingList::Posting& posting : *required_postings.front()) {
+		candidates.emplace_back(posting.document_id, 0.0);
+	}
+	SEARCH_METRIC_ADD(POSTINGS_SCANNED, candidates.size());
+	const auto KeepCandidates = [&candidates](const PostingList& postings, bool contained) {
+		auto cursor = postings.begin();
+		candidates.erase(std::remove_if(candidates.begin(), candidates.end(), [&](const std::pair<int, double>& candidate) {
+			cursor = postings.Gallop(cursor, candidate.first);
+			return (cursor != postings.end() && cursor->document_id == candidate.first) != contained;
+		}), candidates.end());
+	};
+	for (size_t i = 1; i < required_postings.size() && !candidates.empty(); ++i) {
+		KeepCandidates(*required_postings[i], true);
 	}
 	for (const std::string& word : query.minus_words) {
-		if (word_to_document_freqs_.count(word) == 0) {
+		const PostingList* postings = FindPostings(word);
+		if (postings != nullptr && !candidates.empty()) {
+			KeepCandidates(*postings, false);
+		}
+	}
+	if constexpr (!DocumentPredicateTraits<DocumentPredicate>::is_document_filter) {
+		candidates.erase(std::remove_if(candidates.begin(), candidates.end(), [&](const std::pair<int, double>& candidate) {
+			const auto& document_data = documents_.at(candidate.first);
+			return !document_predicate(candidate.first, document_data.status, document_data.rating);
+		}), candidates.end());
+	}
+	SEARCH_METRIC_ADD(DOCUMENTS_SCORED, candidates.size());
+	for (const std::string& word : query.plus_words) {
+		const PostingList* postings = FindPostings(word);
+		if (postings == nullptr) {
 			continue;
 		}
-		for (const auto [document_id, _] : word_to_document_freqs_.at(word)) {
-			document_to_relevance.erase(document_id);
+		const typename Ranker::TermScorer scorer(inverse_document_freq(word), statistics);
+		auto cursor = postings->begin();
+		for (auto& [document_id, relevance] : candidates) {
+			cursor = postings->Gallop(cursor, document_id);
+			if (cursor == postings->end()) {
+				break;
+			}
+			if (cursor->document_id == document_id) {
+				relevance += scorer(cursor->term_freq, cursor->document_length);
+			}
 		}
 	}
-	std::vector<Document> matched_documents;
-	for (const auto [document_id, relevance] : document_to_relevance) {
-		matched_documents.push_back({document_id, relevance, documents_.at(document_id).rating});
-	}
-	return matched_documents;
+	const std::map<int, double> document_to_relevance(candidates.begin(), candidates.end());
+	return BuildMatchedDocuments(query, document_to_relevance, document_predicate);
 }
 
-template <typename DocumentPredicate>
-std::vector<Document> SearchServer::FindAllDocuments(std::execution::parallel_policy, const Query& query, DocumentPredicate document_predicate) const {
+template <typename Ranker, typename DocumentPredicate>
+std::vector<Document> SearchServer::FindAllDocuments(std::execution::sequenced_policy, const Query& query, DocumentPredicate document_predicate, size_t top_count) const {
+	return FindAllDocuments<Ranker>(query, document_predicate, top_count);
+}
+
+template <typename Ranker, typename DocumentPredicate>
+std::vector<Document> SearchServer::FindAllDocuments(std::execution::parallel_policy, const Query& query, DocumentPredicate document_predicate, size_t top_count) const {
+	if (!query.required_words.empty()) {
+		// стоимость пересечения определяется самым коротким списком, делить его между потоками незачем
+		return FindAllDocuments<Ranker>(query, document_predicate, top_count);
+	}
+	SEARCH_METRIC_ADD(QUERIES, 1);
+	const RankingStatistics statistics = GetRankingStatistics();
+	const auto inverse_document_freq = [this](const std::string& word) {
+		return ComputeWordInverseDocumentFreq<Ranker>(word);
+	};
 	ConcurrentMap<int, double> document_to_relevance(4);
-	for (auto word : query.plus_words) {
-		auto it = std::find_if(std::execution::par, word_to_document_freqs_.begin(), word_to_document_freqs_.end(),
-			[&word](auto& pair) {return pair.first == word;});
-		if (it != word_to_document_freqs_.end()) {
-			const double inverse_document_freq = ComputeWordInverseDocumentFreq(word);
-			for_each(std::execution::par, (it->second).begin(), (it->second).end(), 
-				[&] (const std::pair<int, double>  id_freq) {
-				const auto& document_data = documents_.at(id_freq.first);
-				if (document_predicate(id_freq.first, document_data.status, document_data.rating)) {
-					document_to_relevance[id_freq.first] += id_freq.second * inverse_document_freq;
+	std::set<std::string_view> grouped_words;
+	for (const auto& words : GroupPrefixWords(query, grouped_words)) {
+		const auto prefix_scores = ScorePrefixWords<Ranker>(words, statistics, inverse_document_freq);
+		for_each(std::execution::par, prefix_scores.begin(), prefix_scores.end(),
+			[&] (const std::pair<int, double> id_score) {
+			if constexpr (DocumentPredicateTraits<DocumentPredicate>::is_document_filter) {
+				document_to_relevance[id_score.first] += id_score.second;
+			} else {
+				const auto& document_data = documents_.at(id_score.first);
+				if (document_predicate(id_score.first, document_data.status, document_data.rating)) {
+					document_to_relevance[id_score.first] += id_score.second;
+				}
+			}
+		});
+	}
+	for (const std::string& word : query.plus_words) {
+		const PostingList* postings = FindPostings(word);
+		if (postings != nullptr && grouped_words.count(word) == 0) {
+			SEARCH_METRIC_ADD(POSTINGS_SCANNED, postings->size());
+			const typename Ranker::TermScorer scorer(inverse_document_freq(word), statistics);
+			for_each(std::execution::par, postings->begin(), postings->end(), 
+				[&] (const PostingList::Posting& posting) {
+				if constexpr (DocumentPredicateTraits<DocumentPredicate>::is_document_filter) {
+					document_to_relevance[posting.document_id] += scorer(posting.term_freq, posting.document_length);
+				} else {
+					const auto& document_data = documents_.at(posting.document_id);
+					if (document_predicate(posting.document_id, document_data.status, document_data.rating)) {
+						document_to_relevance[posting.document_id] += scorer(posting.term_freq, posting.document_length);
+					}
 				}
 			});
 		}
 	}
-	for (auto word : query.minus_words) {
-		auto it = std::find_if(std::execution::par, word_to_document_freqs_.begin(), word_to_document_freqs_.end(),
-			[&word](auto& pair) {return pair.first == word;});
-		if (it != word_to_document_freqs_.end()) {
-			for (const auto [document_id, _] : it->second) {
-				document_to_relevance.erase(document_id);
+	[[maybe_unused]] size_t excluded_count = 0;
+	for (const std::string& word : query.minus_words) {
+		const PostingList* postings = FindPostings(word);
+		if (postings != nullptr) {
+			SEARCH_METRIC_ADD(POSTINGS_SCANNED, postings->size());
+			for (const PostingList::Posting& posting : *postings) {
+				excluded_count += document_to_relevance.erase(posting.document_id);
 			}
 		}
 	}	
 	std::map<int, double> documents (std::move(document_to_relevance.BuildOrdinaryMap()));
-	std::vector<Document> matched_documents;
-	for (const auto [document_id, relevance] : documents) {
-		matched_documents.push_back({document_id, relevance, documents_.at(document_id).rating});
-	}
-	return matched_documents;
+	SEARCH_METRIC_ADD(DOCUMENTS_SCORED, documents.size() + excluded_count);
+	SEARCH_METRIC_ADD(MINUS_WORD_EXCLUSIONS, excluded_count);
+	return BuildMatchedDocuments(query, documents, document_predicate);
 }
 
 template <typename ExecutionPolicy>
 void SearchServer::RemoveDocument(ExecutionPolicy&& policy, int document_id) {
-	if (document_ids_.count(document_id)) {
-		std::for_each(policy, id_freqs_word_.at(document_id).begin(), id_freqs_word_.at(document_id).begin(),
-			[&](auto& pair) {
-				word_to_document_freqs_.at(pair.first).erase(document_id);
-				if (word_to_document_freqs_.at(pair.first).empty()) {
-					std::mutex tmp; // замедляет непараллельную версию 
-					std::lock_guard guard(tmp);
-					word_to_document_freqs_.erase(pair.first);
-				}
-			});
-		documents_.erase(document_id);
-		document_ids_.erase(document_id);
-		id_freqs_word_.erase(document_id);
+	if (documents_.count(document_id) == 0) {
+		return;
+	}
+	ClearPrefixCache();
+	// без прямого индекса документ ищется во всех списках вхождений
+	std::vector<std::map<std::string, PostingList, std::less<>>::iterator> terms;
+	if (options_.forward_index) {
+		for (const auto& [word, _] : id_freqs_word_.at(document_id)) {
+			terms.push_back(word_to_document_freqs_.find(word));
+		}
+	} else {
+		for (auto it = word_to_document_freqs_.begin(); it != word_to_document_freqs_.end(); ++it) {
+			terms.push_back(it);
+		}
 	}
-}
\ No newline at end of file
+	// каждый поток меняет свой список, само дерево слов здесь не меняется
+	std::for_each(policy, terms.begin(), terms.end(), [this, document_id](auto term) {
+		term->second.Erase(document_id);
+		if (options_.positions) {
+			word_positions_.find(term->first)->second.Erase(document_id);
+		}
+	});
+	for (auto term : terms) {
+		if (term->second.empty()) {
+			word_positions_.erase(term->first);
+			word_to_document_freqs_.erase(term);
+		}
+	}
+	total_document_length_ -= documents_.at(document_id).length;
+	documents_.erase(document_id);
+	id_freqs_word_.erase(document_id);
+}
@@ -0,0 +1,75 @@
+#include "sharded_search_server.h"
+
+ShardedSearchServer::ShardedSearchServer(const std::string& stop_words_text, size_t shard_count)
+: ShardedSearchServer(SplitIntoWords(stop_words_text), shard_count) {
+}
+
+void ShardedSearchServer::AddDocument(int document_id, const std::string_view document, DocumentStatus status, const std::vector<int>& ratings) {
+	if (document_id < 0) {
+		throw std::invalid_argument("Invalid document_id"s);
+	}
+	shards_[GetShardIndex(document_id)].AddDocument(document_id, document, status, ratings);
+}
+
+void ShardedSearchServer::RemoveDocument(int document_id) {
+	if (document_id >= 0) {
+		shards_[GetShardIndex(document_id)].RemoveDocument(document_id);
+	}
+}
+
+void ShardedSearchServer::AddStopWord(const std::string_view word) {
+	for (SearchServer& shard : shards_) {
+		shard.AddStopWord(word);
+	}
+}
+
+void ShardedSearchServer::RemoveStopWord(const std::string_view word) {
+	for (SearchServer& shard : shards_) {
+		shard.RemoveStopWord(word);
+	}
+}
+
+void ShardedSearchServer::PurgeStopWords() {
+	for (SearchServer& shard : shards_) {
+		shard.PurgeStopWords();
+	}
+}
+
+std::vector<Document> ShardedSearchServer::FindTopDocuments(const std::string_view raw_query, DocumentStatus status) const {
+	return FindTopDocuments<TfIdf>(raw_query, status);
+}
+
+std::vector<Document> ShardedSearchServer::FindTopDocuments(const std::string_view raw_query) const {
+	return FindTopDocuments<TfIdf>(raw_query);
+}
+
+SearchServer::WordsInDocument ShardedSearchServer::MatchDocument(const std::string_view raw_query, int document_id) const {
+	if (document_id < 0) {
+		throw std::out_of_range("Invalid document_id"s);
+	}
+	return shards_[GetShardIndex(document_id)].MatchDocument(raw_query, document_id);
+}
+
+int ShardedSearchServer::GetDocumentCount() const {
+	int result = 0;
+	for (const SearchServer& shard : shards_) {
+		result += shard.GetDocumentCount();
+	}
+	return result;
+}
+
+size_t ShardedSearchServer::GetShardCount() const {
+	return shards_.size();
+}
+
+size_t ShardedSearchServer::GetShardIndex(int document_id) const {
+	return static_cast<size_t>(document_id) % shards_.size();
+}
+
+SearchServer::TermStatistics ShardedSearchServer::GetTermStatistics(const std::string_view raw_query) const {
+	SearchServer::TermStatistics result;
+	for (const SearchServer& shard : shards_) {
+		result.Merge(shard.GetTermStatistics(raw_query));
+	}
+	return result;
+}
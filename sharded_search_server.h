@@ -0,0 +1,78 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <execution>
+#include "search_server.h"
+
+// Индекс, разбитый на shard_count частей по document_id % shard_count. Запрос обрабатывается
+// всеми шардами параллельно с общими IDF и средней длиной документа, локальные топы сливаются в один.
+class ShardedSearchServer {
+public:
+	template <typename StringContainer>
+	ShardedSearchServer(const StringContainer& stop_words, size_t shard_count);
+	ShardedSearchServer(const std::string& stop_words_text, size_t shard_count);
+
+	void AddDocument(int document_id, const std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
+	void RemoveDocument(int document_id);
+	// стоп-слова у всех шардов общие, см. SearchServer::AddStopWord
+	void AddStopWord(const std::string_view word);
+	void RemoveStopWord(const std::string_view word);
+	void PurgeStopWords();
+
+	// Ranker — функция ранжирования из ranker.h, как в SearchServer::FindTopDocuments
+	template <typename Ranker = TfIdf, typename DocumentPredicate>
+	std::vector<Document> FindTopDocuments(const std::string_view raw_query, DocumentPredicate document_predicate) const;
+	template <typename Ranker>
+	std::vector<Document> FindTopDocuments(const std::string_view raw_query, DocumentStatus status) const;
+	template <typename Ranker>
+	std::vector<Document> FindTopDocuments(const std::string_view raw_query) const;
+	std::vector<Document> FindTopDocuments(const std::string_view raw_query, DocumentStatus status) const;
+	std::vector<Document> FindTopDocuments(const std::string_view raw_query) const;
+
+	SearchServer::WordsInDocument MatchDocument(const std::string_view raw_query, int document_id) const;
+
+	int GetDocumentCount() const;
+	size_t GetShardCount() const;
+
+private:
+	size_t GetShardIndex(int document_id) const;
+	SearchServer::TermStatistics GetTermStatistics(const std::string_view raw_query) const;
+
+	std::vector<SearchServer> shards_;
+};
+
+template <typename StringContainer>
+ShardedSearchServer::ShardedSearchServer(const StringContainer& stop_words, size_t shard_count) {
+	if (shard_count == 0) {
+		throw std::invalid_argument("Shard count must be positive"s);
+	}
+	shards_.reserve(shard_count);
+	for (size_t i = 0; i < shard_count; ++i) {
+		shards_.emplace_back(stop_words);
+	}
+}
+
+template <typename Ranker, typename DocumentPredicate>
+std::vector<Document> ShardedSearchServer::FindTopDocuments(const std::string_view raw_query, DocumentPredicate document_predicate) const {
+	const auto statistics = GetTermStatistics(raw_query);
+	std::vector<std::vector<Document>> shard_results(shards_.size());
+	std::transform(std::execution::par, shards_.begin(), shards_.end(), shard_results.begin(),
+		[&](const SearchServer& shard) {
+			return shard.FindTopDocuments<Ranker>(raw_query, statistics, document_predicate);
+		});
+	return MergeTopDocuments(shard_results, MAX_RESULT_DOCUMENT_COUNT);
+}
+
+template <typename Ranker>
+std::vector<Document> ShardedSearchServer::FindTopDocuments(const std::string_view raw_query, DocumentStatus status) const {
+	return VisitStatusPredicate(status, [&](auto document_predicate) {
+		return FindTopDocuments<Ranker>(raw_query, document_predicate);
+	});
+}
+
+template <typename Ranker>
+std::vector<Document> ShardedSearchServer::FindTopDocuments(const std::string_view raw_query) const {
+	return FindTopDocuments<Ranker>(raw_query, DocumentStatus::ACTUAL);
+}
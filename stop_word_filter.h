@@ -0,0 +1,160 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Множество стоп-слов для проверки каждого слова документа и запроса без выделения памяти.
+// Сначала слово проверяется по фильтру Блума: большинство слов не стоп-слова и отсекаются
+// одним обращением к массиву битов. Остальные ищутся в открытой хеш-таблице с линейным пробированием.
+// Удаление перестраивает таблицу и фильтр целиком — стоп-слова меняются редко.
+class StopWordFilter {
+public:
+	StopWordFilter() = default;
+
+	template <typename StringContainer>
+	explicit StopWordFilter(const StringContainer& words) {
+		for (const auto& word : words) {
+			Add(word);
+		}
+	}
+
+	// false, если слово уже есть
+	bool Add(std::string_view word) {
+		if (Contains(word)) {
+			return false;
+		}
+		if ((size_ + 1) * 2 > slots_.size()) {
+			Rehash(std::max<size_t>(slots_.size() * 2, 16));
+		}
+		Insert(std::string(word), Hash(word));
+		return true;
+	}
+
+	// false, если слова нет
+	bool Remove(std::string_view word) {
+		if (!Contains(word)) {
+			return false;
+		}
+		std::vector<Slot> old_slots = std::move(slots_);
+		slots_.assign(old_slots.size(), Slot());
+		bloom_.assign(bloom_.size(), 0);
+		size_ = 0;
+		for (Slot& slot : old_slots) {
+			if (!slot.word.empty() && slot.word != word) {
+				Insert(std::move(slot.word), slot.hash);
+			}
+		}
+		return true;
+	}
+
+	bool Contains(std::string_view word) const {
+		if (size_ == 0) {
+			return false;
+		}
+		const size_t hash = Hash(word);
+		if (!MayContain(hash)) {
+			return false;
+		}
+		const size_t mask = slots_.size() - 1;
+		for (size_t i = hash & mask;; i = (i + 1) & mask) {
+			const Slot& slot = slots_[i];
+			if (slot.word.empty()) {
+				return false;
+			}
+			if (slot.hash == hash && slot.word == word) {
+				return true;
+			}
+		}
+	}
+
+	size_t size() const {
+		return size_;
+	}
+
+	bool empty() const {
+		return size_ == 0;
+	}
+
+	// слова по возрастанию
+	std::vector<std::string_view> GetWords() const {
+		std::vector<std::string_view> result;
+		result.reserve(size_);
+		for (const Slot& slot : slots_) {
+			if (!slot.word.empty()) {
+				result.push_back(slot.word);
+			}
+		}
+		std::sort(result.begin(), result.end());
+		return result;
+	}
+
+	size_t GetMemoryUsage() const {
+		size_t result = slots_.capacity() * sizeof(Slot) + bloom_.capacity() * sizeof(uint64_t);
+		for (const Slot& slot : slots_) {
+			if (slot.word.capacity() > std::string().capacity()) {
+				result += slot.word.capacity() + 1;
+			}
+		}
+		return result;
+	}
+
+private:
+	// пустое слово — свободная ячейка: стоп-слова непустые
+	struct Slot {
+		size_t hash = 0;
+		std::string word;
+	};
+
+	static size_t Hash(std::string_view word) {
+		return std::hash<std::string_view>()(word);
+	}
+
+	// два бита на слово из разных частей хеша; битов в 8 раз больше, чем ячеек таблицы
+	size_t FirstBloomBit(size_t hash) const {
+		return (hash >> 7) & (bloom_.size() * 64 - 1);
+	}
+
+	size_t SecondBloomBit(size_t hash) const {
+		return ((hash >> 37) ^ ((hash * 0x9E3779B97F4A7C15ull) >> 40)) & (bloom_.size() * 64 - 1);
+	}
+
+	bool MayContain(size_t hash) const {
+		const size_t first = FirstBloomBit(hash);
+		const size_t second = SecondBloomBit(hash);
+		return ((bloom_[first / 64] >> (first % 64)) & 1) && ((bloom_[second / 64] >> (second % 64)) & 1);
+	}
+
+	void Insert(std::string word, size_t hash) {
+		const size_t mask = slots_.size() - 1;
+		size_t i = hash & mask;
+		while (!slots_[i].word.empty()) {
+			i = (i + 1) & mask;
+		}
+		slots_[i] = Slot{hash, std::move(word)};
+		const size_t first = FirstBloomBit(hash);
+		const size_t second = SecondBloomBit(hash);
+		bloom_[first / 64] |= uint64_t(1) << (first % 64);
+		bloom_[second / 64] |= uint64_t(1) << (second % 64);
+		++size_;
+	}
+
+	void Rehash(size_t slot_count) {
+		std::vector<Slot> old_slots = std::move(slots_);
+		slots_.assign(slot_count, Slot());
+		bloom_.assign(slot_count * 8 / 64, 0);
+		size_ = 0;
+		for (Slot& slot : old_slots) {
+			if (!slot.word.empty()) {
+				Insert(std::move(slot.word), slot.hash);
+			}
+		}
+	}
+
+	std::vector<Slot> slots_;
+	std::vector<uint64_t> bloom_;
+	size_t size_ = 0;
+};
@@ -144,4 +144,962 @@ int main() {
 
     TEST(seq);
     TEST(par);
-} 
\ No newline at end of file
+} 
+
+// TEST RequestQueue
+
+// окно — последние 1440 запросов: при обороте кольца вытесняются самые старые,
+// в том числе когда запросы добавляются из нескольких потоков
+int main() {
+    SearchServer search_server("и в на"s);
+    search_server.AddDocument(1, "пушистый кот и пушистый хвост"s, DocumentStatus::ACTUAL, {7});
+    RequestQueue request_queue(search_server);
+    for (int i = 0; i < 1439; ++i) {
+        request_queue.AddFindRequest("пустой запрос"s);
+    }
+    assert(request_queue.GetNoResultRequests() == 1439);
+    request_queue.AddFindRequest("кот"s);
+    assert(request_queue.GetNoResultRequests() == 1439 && request_queue.GetRequestCount() == 1440);
+    request_queue.AddFindRequest("кот"s);
+    assert(request_queue.GetNoResultRequests() == 1438 && request_queue.GetRequestCount() == 1440);
+    for (int i = 0; i < 3 * 1440 + 1; ++i) {
+        request_queue.AddFindRequest(i % 2 == 0 ? "кот"s : "собака"s);
+    }
+    assert(request_queue.GetNoResultRequests() == 720 && request_queue.GetHitCount() == 720);
+
+    RequestQueue concurrent_queue(search_server);
+    vector<thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&concurrent_queue, t] {
+            for (int i = 0; i < 10'000; ++i) {
+                concurrent_queue.AddFindRequest((t + i) % 3 == 0 ? "собака"s : "кот"s);
+            }
+        });
+    }
+    for (thread& worker : threads) {
+        worker.join();
+    }
+    assert(concurrent_queue.GetRequestCount() == 1440);
+    assert(concurrent_queue.GetNoResultRequests() + concurrent_queue.GetHitCount() == 1440);
+    const auto histogram = concurrent_queue.GetLatencyHistogram();
+    assert(accumulate(histogram.begin(), histogram.end(), 0) == 1440);
+    cout << "no result: "s << concurrent_queue.GetNoResultRequests() << " of 1440"s << endl;
+}
+
+// TEST Pagination
+
+string GenerateWord(mt19937& generator, int max_length) {
+    const int length = uniform_int_distribution(1, max_length)(generator);
+    string word;
+    word.reserve(length);
+    for (int i = 0; i < length; ++i) {
+        word.push_back(uniform_int_distribution('a', 'z')(generator));
+    }
+    return word;
+}
+
+vector<string> GenerateDictionary(mt19937& generator, int word_count, int max_length) {
+    vector<string> words;
+    words.reserve(word_count);
+    for (int i = 0; i < word_count; ++i) {
+        words.push_back(GenerateWord(generator, max_length));
+    }
+    sort(words.begin(), words.end());
+    words.erase(unique(words.begin(), words.end()), words.end());
+    return words;
+}
+
+string GenerateQuery(mt19937& generator, const vector<string>& dictionary, int word_count) {
+    string query;
+    for (int i = 0; i < word_count; ++i) {
+        if (!query.empty()) {
+            query.push_back(' ');
+        }
+        query += dictionary[uniform_int_distribution<int>(0, dictionary.size() - 1)(generator)];
+    }
+    return query;
+}
+
+// документы с равными релевантностью и рейтингом могут идти в любом порядке
+template <typename Range>
+bool HaveSameRanking(const Range& lhs, const vector<Document>& rhs) {
+    if (static_cast<size_t>(distance(lhs.begin(), lhs.end())) != rhs.size()) {
+        return false;
+    }
+    auto it = lhs.begin();
+    for (const Document& document : rhs) {
+        if (abs(it->relevance - document.relevance) >= 1e-6 || it->rating != document.rating) {
+            return false;
+        }
+        ++it;
+    }
+    return true;
+}
+
+// ленивые страницы курсора и FindTopDocuments(query, page, page_size) совпадают с разбиением
+// полностью упорядоченной выдачи, включая неполную последнюю страницу и пустую выдачу
+int main() {
+    mt19937 generator;
+    const auto dictionary = GenerateDictionary(generator, 300, 8);
+    SearchServer search_server(""s);
+    for (int i = 0; i < 2000; ++i) {
+        search_server.AddDocument(i, GenerateQuery(generator, dictionary, 3 + i % 20), DocumentStatus::ACTUAL, {i % 7});
+    }
+    int pages_checked = 0;
+    for (int i = 0; i < 200; ++i) {
+        const string query = i == 0 ? "несуществующее"s : GenerateQuery(generator, dictionary, 1 + i % 3);
+        const size_t page_size = 1 + i % 9;
+        const auto all_documents = search_server.FindTopDocuments(query, 0, search_server.GetDocumentCount());
+        auto cursor = search_server.FindDocumentPages(query, page_size);
+        assert(cursor.size() == all_documents.size());
+        size_t page_index = 0;
+        for (const auto& page : Paginate(all_documents, page_size)) {
+            const vector<Document> expected(page.begin(), page.end());
+            assert(cursor.HasNextPage());
+            assert(HaveSameRanking(cursor.NextPage(), expected));
+            assert(HaveSameRanking(search_server.FindTopDocuments(query, page_index, page_size), expected));
+            ++page_index;
+            ++pages_checked;
+        }
+        assert(!cursor.HasNextPage() && cursor.NextPage().begin() == cursor.NextPage().end());
+        assert(search_server.FindTopDocuments(query, page_index, page_size).empty());
+        if (i == 0) {
+            assert(all_documents.empty() && page_index == 0);
+        }
+    }
+    cout << "pages checked: "s << pages_checked << endl;
+}
+
+// TEST FindTopDocumentsAsync
+
+string GenerateWord(mt19937& generator, int max_length) {
+    const int length = uniform_int_distribution(1, max_length)(generator);
+    string word;
+    word.reserve(length);
+    for (int i = 0; i < length; ++i) {
+        word.push_back(uniform_int_distribution('a', 'z')(generator));
+    }
+    return word;
+}
+
+vector<string> GenerateDictionary(mt19937& generator, int word_count, int max_length) {
+    vector<string> words;
+    words.reserve(word_count);
+    for (int i = 0; i < word_count; ++i) {
+        words.push_back(GenerateWord(generator, max_length));
+    }
+    sort(words.begin(), words.end());
+    words.erase(unique(words.begin(), words.end()), words.end());
+    return words;
+}
+
+string GenerateQuery(mt19937& generator, const vector<string>& dictionary, int word_count, double minus_prob = 0) {
+    string query;
+    for (int i = 0; i < word_count; ++i) {
+        if (!query.empty()) {
+            query.push_back(' ');
+        }
+        if (uniform_real_distribution<>(0, 1)(generator) < minus_prob) {
+            query.push_back('-');
+        }
+        query += dictionary[uniform_int_distribution<int>(0, dictionary.size() - 1)(generator)];
+    }
+    return query;
+}
+
+vector<string> GenerateQueries(mt19937& generator, const vector<string>& dictionary, int query_count, int max_word_count) {
+    vector<string> queries;
+    queries.reserve(query_count);
+    for (int i = 0; i < query_count; ++i) {
+        queries.push_back(GenerateQuery(generator, dictionary, max_word_count));
+    }
+    return queries;
+}
+
+// держит в полёте не больше in_flight запросов и печатает пропускную способность и латентность
+void Test(const SearchServer& search_server, const vector<string>& queries, int in_flight) {
+    using Clock = chrono::steady_clock;
+    vector<Clock::duration> latencies(queries.size());
+    atomic<int> active = 0;
+    const auto start_time = Clock::now();
+    for (size_t i = 0; i < queries.size(); ++i) {
+        while (active.load() >= in_flight) {
+            this_thread::yield();
+        }
+        ++active;
+        const auto submit_time = Clock::now();
+        while (!search_server.TrySubmitFindTopDocuments(queries[i], [&, i, submit_time](vector<Document>, exception_ptr) {
+            latencies[i] = Clock::now() - submit_time;
+            --active;
+        })) {
+            this_thread::yield();
+        }
+    }
+    while (active.load() > 0) {
+        this_thread::yield();
+    }
+    const double seconds = chrono::duration<double>(Clock::now() - start_time).count();
+    sort(latencies.begin(), latencies.end());
+    const auto percentile = [&latencies](double p) {
+        return chrono::duration_cast<chrono::microseconds>(latencies[static_cast<size_t>(p * (latencies.size() - 1))]).count();
+    };
+    cout << "in_flight = "s << in_flight << ", qps = "s << queries.size() / seconds
+         << ", p50 = "s << percentile(0.5) << " us, p99 = "s << percentile(0.99) << " us"s << endl;
+}
+
+int main() {
+    mt19937 generator;
+
+    const auto dictionary = GenerateDictionary(generator, 1000, 10);
+    const auto documents = GenerateQueries(generator, dictionary, 10'000, 70);
+
+    SearchServer search_server(dictionary[0]);
+    for (size_t i = 0; i < documents.size(); ++i) {
+        search_server.AddDocument(i, documents[i], DocumentStatus::ACTUAL, {1, 2, 3});
+    }
+    ThreadPool::Options options;
+    options.max_queued_tasks = 256;
+    search_server.ConfigureExecutor(options);
+
+    const auto queries = GenerateQueries(generator, dictionary, 2'000, 10);
+    for (int in_flight : {1, 2, 4, 8, 16, 64, 256}) {
+        Test(search_server, queries, in_flight);
+    }
+}
+
+
+// TEST ShardedSearchServer
+
+string GenerateWord(mt19937& generator, int max_length) {
+    const int length = uniform_int_distribution(1, max_length)(generator);
+    string word;
+    word.reserve(length);
+    for (int i = 0; i < length; ++i) {
+        word.push_back(uniform_int_distribution('a', 'z')(generator));
+    }
+    return word;
+}
+
+vector<string> GenerateDictionary(mt19937& generator, int word_count, int max_length) {
+    vector<string> words;
+    words.reserve(word_count);
+    for (int i = 0; i < word_count; ++i) {
+        words.push_back(GenerateWord(generator, max_length));
+    }
+    sort(words.begin(), words.end());
+    words.erase(unique(words.begin(), words.end()), words.end());
+    return words;
+}
+
+string GenerateQuery(mt19937& generator, const vector<string>& dictionary, int word_count, double minus_prob = 0) {
+    string query;
+    for (int i = 0; i < word_count; ++i) {
+        if (!query.empty()) {
+            query.push_back(' ');
+        }
+        if (uniform_real_distribution<>(0, 1)(generator) < minus_prob) {
+            query.push_back('-');
+        }
+        query += dictionary[uniform_int_distribution<int>(0, dictionary.size() - 1)(generator)];
+    }
+    return query;
+}
+
+vector<string> GenerateQueries(mt19937& generator, const vector<string>& dictionary, int query_count, int max_word_count) {
+    vector<string> queries;
+    queries.reserve(query_count);
+    for (int i = 0; i < query_count; ++i) {
+        queries.push_back(GenerateQuery(generator, dictionary, max_word_count));
+    }
+    return queries;
+}
+
+void Test(const vector<string>& dictionary, const vector<string>& documents, const vector<string>& queries, size_t shard_count) {
+    ShardedSearchServer search_server(dictionary[0], shard_count);
+    for (size_t i = 0; i < documents.size(); ++i) {
+        search_server.AddDocument(i, documents[i], DocumentStatus::ACTUAL, {1, 2, 3});
+    }
+    LOG_DURATION("shards = "s + to_string(shard_count));
+    double total_relevance = 0;
+    for (const string_view query : queries) {
+        for (const auto& document : search_server.FindTopDocuments(query)) {
+            total_relevance += document.relevance;
+        }
+    }
+    cout << total_relevance << endl;
+}
+
+int main() {
+    mt19937 generator;
+
+    const auto dictionary = GenerateDictionary(generator, 1000, 10);
+    const auto documents = GenerateQueries(generator, dictionary, 10'000, 70);
+    const auto queries = GenerateQueries(generator, dictionary, 100, 70);
+
+    for (size_t shard_count : {1, 2, 4, 8, 16}) {
+        Test(dictionary, documents, queries, shard_count);
+    }
+
+    // однобуквенному префиксу подходит больше MAX_PREFIX_EXPANSION_COUNT слов,
+    // и шарды должны выбрать те же слова, что и один индекс
+    const auto prefix_dictionary = GenerateDictionary(generator, 3000, 8);
+    const auto prefix_documents = GenerateQueries(generator, prefix_dictionary, 5'000, 40);
+    SearchServer single_server(prefix_dictionary[0]);
+    ShardedSearchServer sharded_server(prefix_dictionary[0], 4);
+    for (size_t i = 0; i < prefix_documents.size(); ++i) {
+        single_server.AddDocument(i, prefix_documents[i], DocumentStatus::ACTUAL, {1, 2, 3});
+        sharded_server.AddDocument(i, prefix_documents[i], DocumentStatus::ACTUAL, {1, 2, 3});
+    }
+    int mismatches = 0;
+    for (char letter = 'a'; letter <= 'z'; ++letter) {
+        const string query = string(1, letter) + "*"s;
+        const auto expected = single_server.FindTopDocuments(query);
+        const auto results = sharded_server.FindTopDocuments(query);
+        for (size_t i = 0; i < expected.size(); ++i) {
+            mismatches += i >= results.size() || abs(results[i].relevance - expected[i].relevance) > 1e-6;
+        }
+    }
+    cout << "prefix mismatches = "s << mismatches << endl;
+
+    // Bm25 берёт у шардов общие число документов и среднюю длину, поэтому тоже совпадает с одним индексом;
+    // у документов одной длины релевантности равны, и среди них шарды могут выбрать другие id
+    vector<string> bm25_queries;
+    for (int i = 0; i < 100; ++i) {
+        bm25_queries.push_back(GenerateQuery(generator, prefix_dictionary, 1 + i % 5, 0.2));
+    }
+    for (char letter = 'a'; letter <= 'z'; ++letter) {
+        bm25_queries.push_back(string(1, letter) + "*"s);
+    }
+    int bm25_mismatches = 0;
+    for (const string& query : bm25_queries) {
+        const auto expected = single_server.FindTopDocuments<Bm25>(query);
+        const auto results = sharded_server.FindTopDocuments<Bm25>(query);
+        bm25_mismatches += results.size() != expected.size();
+        for (size_t i = 0; i < expected.size() && i < results.size(); ++i) {
+            bm25_mismatches += results[i].rating != expected[i].rating || abs(results[i].relevance - expected[i].relevance) > 1e-6;
+        }
+    }
+    cout << "bm25 mismatches = "s << bm25_mismatches << endl;
+}
+
+
+// TEST SearchCoordinator
+
+string GenerateWord(mt19937& generator, int max_length) {
+    const int length = uniform_int_distribution(1, max_length)(generator);
+    string word;
+    word.reserve(length);
+    for (int i = 0; i < length; ++i) {
+        word.push_back(uniform_int_distribution('a', 'z')(generator));
+    }
+    return word;
+}
+
+vector<string> GenerateDictionary(mt19937& generator, int word_count, int max_length) {
+    vector<string> words;
+    words.reserve(word_count);
+    for (int i = 0; i < word_count; ++i) {
+        words.push_back(GenerateWord(generator, max_length));
+    }
+    sort(words.begin(), words.end());
+    words.erase(unique(words.begin(), words.end()), words.end());
+    return words;
+}
+
+string GenerateQuery(mt19937& generator, const vector<string>& dictionary, int word_count, double minus_prob = 0) {
+    string query;
+    for (int i = 0; i < word_count; ++i) {
+        if (!query.empty()) {
+            query.push_back(' ');
+        }
+        if (uniform_real_distribution<>(0, 1)(generator) < minus_prob) {
+            query.push_back('-');
+        }
+        query += dictionary[uniform_int_distribution<int>(0, dictionary.size() - 1)(generator)];
+    }
+    return query;
+}
+
+vector<string> GenerateQueries(mt19937& generator, const vector<string>& dictionary, int query_count, int max_word_count) {
+    vector<string> queries;
+    queries.reserve(query_count);
+    for (int i = 0; i < query_count; ++i) {
+        queries.push_back(GenerateQuery(generator, dictionary, max_word_count));
+    }
+    return queries;
+}
+
+// листы — дочерние процессы, каждый со своей частью документов (id % leaf_count)
+int main() {
+    mt19937 generator;
+
+    const auto dictionary = GenerateDictionary(generator, 1000, 10);
+    const auto documents = GenerateQueries(generator, dictionary, 10'000, 70);
+    auto queries = GenerateQueries(generator, dictionary, 100, 5);
+    // слова префикса выбираются по общей статистике, а не в каждом листе отдельно
+    for (char letter = 'a'; letter <= 'z'; ++letter) {
+        queries.push_back(string(1, letter) + "*"s);
+    }
+    const int leaf_count = 4;
+
+    vector<string> addresses;
+    vector<pid_t> leaves;
+    for (int leaf = 0; leaf < leaf_count; ++leaf) {
+        addresses.push_back("unix:/tmp/search_leaf_"s + to_string(leaf) + ".sock"s);
+        const pid_t pid = fork();
+        if (pid == 0) {
+            SearchServer search_server(dictionary[0]);
+            for (size_t i = leaf; i < documents.size(); i += leaf_count) {
+                search_server.AddDocument(i, documents[i], DocumentStatus::ACTUAL, {1, 2, 3});
+            }
+            SearchLeaf(search_server).Serve(addresses.back());
+            return 0;
+        }
+        leaves.push_back(pid);
+    }
+
+    SearchServer search_server(dictionary[0]);
+    for (size_t i = 0; i < documents.size(); ++i) {
+        search_server.AddDocument(i, documents[i], DocumentStatus::ACTUAL, {1, 2, 3});
+    }
+    this_thread::sleep_for(1s);
+
+    SearchCoordinator coordinator(addresses);
+    int mismatches = 0;
+    {
+        LOG_DURATION("coordinator"s);
+        const auto results = coordinator.FindTopDocuments(queries);
+        for (size_t i = 0; i < queries.size(); ++i) {
+            const auto expected = search_server.FindTopDocuments(queries[i]);
+            for (size_t j = 0; j < expected.size(); ++j) {
+                mismatches += j >= results[i].size() || abs(results[i][j].relevance - expected[j].relevance) > 1e-6;
+            }
+        }
+    }
+    // номер функции ранжирования уходит листам вместе с запросом
+    int bm25_mismatches = 0;
+    const auto bm25_results = coordinator.FindTopDocuments<Bm25>(queries);
+    for (size_t i = 0; i < queries.size(); ++i) {
+        const auto expected = search_server.FindTopDocuments<Bm25>(queries[i]);
+        for (size_t j = 0; j < expected.size(); ++j) {
+            bm25_mismatches += j >= bm25_results[i].size() || abs(bm25_results[i][j].relevance - expected[j].relevance) > 1e-6;
+        }
+    }
+    const auto [words, status] = coordinator.MatchDocument(queries[0], 42);
+    cout << "mismatches = "s << mismatches << ", bm25 mismatches = "s << bm25_mismatches << ", failed leaves = "s << coordinator.GetFailedLeafCount()
+         << ", matched words in 42 = "s << words.size() << endl;
+
+    for (pid_t pid : leaves) {
+        kill(pid, SIGKILL);
+        waitpid(pid, nullptr, 0);
+    }
+}
+
+
+// TEST RequiredWords
+
+string GenerateWord(mt19937& generator, int max_length) {
+    const int length = uniform_int_distribution(1, max_length)(generator);
+    string word;
+    word.reserve(length);
+    for (int i = 0; i < length; ++i) {
+        word.push_back(uniform_int_distribution('a', 'z')(generator));
+    }
+    return word;
+}
+
+vector<string> GenerateDictionary(mt19937& generator, int word_count, int max_length) {
+    vector<string> words;
+    words.reserve(word_count);
+    for (int i = 0; i < word_count; ++i) {
+        words.push_back(GenerateWord(generator, max_length));
+    }
+    sort(words.begin(), words.end());
+    words.erase(unique(words.begin(), words.end()), words.end());
+    return words;
+}
+
+string GenerateQuery(mt19937& generator, const vector<string>& dictionary, int word_count) {
+    string query;
+    for (int i = 0; i < word_count; ++i) {
+        if (!query.empty()) {
+            query.push_back(' ');
+        }
+        query += dictionary[uniform_int_distribution<int>(0, dictionary.size() - 1)(generator)];
+    }
+    return query;
+}
+
+// документы с равными релевантностью и рейтингом могут идти в любом порядке
+bool HaveSameRanking(const vector<Document>& lhs, const vector<Document>& rhs) {
+    if (lhs.size() != rhs.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < lhs.size(); ++i) {
+        if (abs(lhs[i].relevance - rhs[i].relevance) >= 1e-6 || lhs[i].rating != rhs[i].rating) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Gallop совпадает с lower_bound от любой стартовой позиции, в том числе когда шаг
+// упирается в конец списка и когда искомый id левее первого или правее последнего
+void TestGallop() {
+    for (int size = 0; size <= 40; ++size) {
+        PostingList postings;
+        for (int i = 0; i < size; ++i) {
+            postings.Add(2 * i + 1, 1.0, 1);
+        }
+        for (auto from = postings.begin();; ++from) {
+            for (int document_id = -1; document_id <= 2 * size + 1; ++document_id) {
+                const auto expected = lower_bound(from, postings.end(), document_id, [](const PostingList::Posting& posting, int id) {
+                    return posting.document_id < id;
+                });
+                assert(postings.Gallop(from, document_id) == expected);
+            }
+            if (from == postings.end()) {
+                break;
+            }
+        }
+    }
+}
+
+// "+слово" выдаёт то же, что полный поиск, отфильтрованный по наличию всех обязательных слов
+int main() {
+    TestGallop();
+
+    mt19937 generator;
+    const auto dictionary = GenerateDictionary(generator, 300, 8);
+    SearchServer search_server(""s);
+    const int document_count = 2000;
+    for (int i = 0; i < document_count; ++i) {
+        string text = GenerateQuery(generator, dictionary, 3 + i % 20);
+        // редкие слова в первом и последнем документах: обязательный список из одного элемента
+        // на краю, и списки остальных слов кончаются раньше или позже него
+        if (i == 0) {
+            text += " first"s;
+        }
+        if (i == document_count - 1) {
+            text += " last"s;
+        }
+        if (i == 0 || i == document_count - 1) {
+            text += " edge"s;
+        }
+        search_server.AddDocument(i, text, DocumentStatus::ACTUAL, {i % 7});
+    }
+
+    vector<pair<string, vector<string>>> queries = {
+        {"+first "s + dictionary[0], {"first"s}},
+        {"+last "s + dictionary[1], {"last"s}},
+        {"+edge first last"s, {"edge"s}},
+        {"+first +last"s, {"first"s, "last"s}},
+        {"+edge -last"s, {"edge"s}},
+        {"+missing "s + dictionary[2], {"missing"s}},
+        {"+"s + dictionary[3] + " "s + dictionary[4].substr(0, 1) + "*"s, {dictionary[3]}},
+    };
+    for (int i = 0; i < 300; ++i) {
+        const string text = GenerateQuery(generator, dictionary, 2 + i % 4);
+        const auto words = SplitIntoWords(text);
+        string query;
+        vector<string> required_words;
+        for (size_t j = 0; j < words.size(); ++j) {
+            const string word(words[j]);
+            if (j == 0 || (j == 1 && i % 2 == 0)) {
+                query += "+"s + word + " "s;
+                required_words.push_back(word);
+            } else if (j == words.size() - 1 && i % 3 == 0) {
+                query += "-"s + word + " "s;
+            } else {
+                query += word + " "s;
+            }
+        }
+        query.pop_back();
+        queries.push_back({query, required_words});
+    }
+
+    int checked_documents = 0;
+    for (const auto& [query, required_words] : queries) {
+        string plain_query = query;
+        plain_query.erase(remove(plain_query.begin(), plain_query.end(), '+'), plain_query.end());
+        const auto contains_required = [&search_server, &required = required_words](int document_id, DocumentStatus, int) {
+            const auto& word_freqs = search_server.GetWordFrequencies(document_id);
+            return all_of(required.begin(), required.end(), [&word_freqs](const string& word) {
+                return word_freqs.count(word) > 0;
+            });
+        };
+        const auto expected = search_server.FindTopDocuments(plain_query, contains_required, 0, document_count);
+        const auto actual = search_server.FindTopDocuments(query, [](int, DocumentStatus, int) { return true; }, 0, document_count);
+        assert(HaveSameRanking(actual, expected));
+        assert(HaveSameRanking(search_server.FindTopDocuments(execution::par, query), search_server.FindTopDocuments(plain_query, contains_required)));
+        checked_documents += expected.size();
+    }
+    assert(search_server.FindTopDocuments("+first +last"s).empty());
+    assert(search_server.FindTopDocuments("+edge"s).size() == 2);
+    cout << "required queries: "s << queries.size() << ", documents checked: "s << checked_documents << endl;
+}
+
+
+// TEST ReloadableSearchServer
+
+template <typename Function>
+bool ThrowsRuntimeError(Function function) {
+    try {
+        function();
+    } catch (const runtime_error&) {
+        return true;
+    }
+    return false;
+}
+
+// снимок переживает сохранение и загрузку, а любой обрезанный или испорченный снимок
+// отвергается с std::runtime_error, не выделяя память по записанным в нём размерам
+void TestSnapshotValidation() {
+    IndexOptions options;
+    options.positions = true;
+    SearchServer search_server(""s, options);
+    search_server.AddDocument(1, "cat in the city"s, DocumentStatus::ACTUAL, {5});
+    search_server.AddDocument(2, "dog in the city"s, DocumentStatus::BANNED, {-3});
+    ostringstream out;
+    search_server.SaveSnapshot(out);
+    const string snapshot = out.str();
+
+    istringstream in(snapshot);
+    const SearchServer loaded = SearchServer::LoadSnapshot(in);
+    assert(loaded.GetDocumentCount() == 2);
+    assert(loaded.GetWordFrequencies(2) == search_server.GetWordFrequencies(2));
+    assert(loaded.FindTopDocuments("\"in the city\""s).size() == 1);
+
+    for (size_t size = 0; size < snapshot.size(); ++size) {
+        assert(ThrowsRuntimeError([&] {
+            istringstream truncated(snapshot.substr(0, size));
+            SearchServer::LoadSnapshot(truncated);
+        }));
+    }
+    // магия, версия и два флага, затем число стоп-слов, число документов и первый документ
+    const size_t stop_word_count_offset = 10;
+    const size_t document_count_offset = 14;
+    const size_t first_status_offset = 26;
+    // после двух документов по 13 байт — число слов и длина первого слова
+    const size_t first_word_size_offset = document_count_offset + 4 + 2 * 13 + 4;
+    const auto Corrupt = [&snapshot](size_t offset, const string& bytes) {
+        string corrupted = snapshot;
+        corrupted.replace(offset, bytes.size(), bytes);
+        return [corrupted] {
+            istringstream in(corrupted);
+            SearchServer::LoadSnapshot(in);
+        };
+    };
+    assert(ThrowsRuntimeError(Corrupt(stop_word_count_offset, "\xff\xff\xff\xff"s)));
+    assert(ThrowsRuntimeError(Corrupt(document_count_offset, "\xff\xff\xff\x7f"s)));
+    assert(ThrowsRuntimeError(Corrupt(first_status_offset, "\x07"s)));
+    assert(ThrowsRuntimeError(Corrupt(first_word_size_offset, "\xff\xff\xff\xff"s)));
+}
+
+// читатели непрерывно ищут, пока индекс несколько раз подменяется, в том числе из снимка на диске
+int main() {
+    TestSnapshotValidation();
+
+    using Clock = chrono::steady_clock;
+    mt19937 generator;
+
+    const auto dictionary = GenerateDictionary(generator, 1000, 10);
+    const auto documents = GenerateQueries(generator, dictionary, 10'000, 70);
+    const auto queries = GenerateQueries(generator, dictionary, 1'000, 5);
+    const auto BuildServer = [&](size_t first_document) {
+        SearchServer search_server(dictionary[0]);
+        for (size_t i = first_document; i < documents.size(); ++i) {
+            search_server.AddDocument(i, documents[i], DocumentStatus::ACTUAL, {1, 2, 3});
+        }
+        return search_server;
+    };
+
+    ReloadableSearchServer reloadable_server(BuildServer(0));
+    atomic<bool> stopping = false;
+    atomic<size_t> completed = 0;
+    atomic<size_t> failed = 0;
+    vector<Clock::duration> max_latencies(4);
+    vector<thread> readers;
+    for (size_t reader = 0; reader < max_latencies.size(); ++reader) {
+        readers.emplace_back([&, reader] {
+            for (size_t i = reader; !stopping; i = (i + 1) % queries.size()) {
+                const auto start_time = Clock::now();
+                try {
+                    const auto search_server = reloadable_server.Acquire();
+                    search_server->FindTopDocuments(queries[i]);
+                    if (i % 10 == 0) {
+                        ProcessQueries(*search_server, vector<string>(queries.begin() + i, queries.begin() + min(i + 10, queries.size())));
+                    }
+                    ++completed;
+                } catch (...) {
+                    ++failed;
+                }
+                max_latencies[reader] = max(max_latencies[reader], Clock::now() - start_time);
+            }
+        });
+    }
+
+    const string snapshot_path = "/tmp/search_server.snapshot"s;
+    for (int generation = 1; generation <= 6; ++generation) {
+        SearchServer search_server = BuildServer(generation * 100);
+        LOG_DURATION("reload "s + to_string(generation));
+        if (generation % 2 == 0) {
+            {
+                ofstream out(snapshot_path, ios::binary);
+                search_server.SaveSnapshot(out);
+            }
+            reloadable_server.ReloadFromSnapshot(snapshot_path);
+        } else {
+            reloadable_server.Reload(move(search_server));
+        }
+    }
+    stopping = true;
+    for (thread& reader : readers) {
+        reader.join();
+    }
+    cout << "generation = "s << reloadable_server.GetGeneration() << ", documents = "s << reloadable_server.Acquire()->GetDocumentCount()
+         << ", queries = "s << completed << ", failed = "s << failed
+         << ", max latency = "s << chrono::duration_cast<chrono::milliseconds>(*max_element(max_latencies.begin(), max_latencies.end())).count() << " ms"s << endl;
+}
+
+// TEST StopWordFilter
+
+int main() {
+    SearchServer search_server("и в на"s);
+    search_server.AddDocument(1, "белый кот и модный ошейник"s, DocumentStatus::ACTUAL, {1});
+    search_server.AddDocument(2, "пушистый кот пушистый хвост"s, DocumentStatus::ACTUAL, {2});
+    search_server.AddDocument(3, "ухоженный пёс выразительные глаза"s, DocumentStatus::ACTUAL, {3});
+
+    // новое стоп-слово сразу исчезает из запросов, в том числе из уже запомненных префиксов,
+    // а вхождения удаляются позже
+    assert(search_server.FindTopDocuments("к*"s).size() == 2);
+    search_server.AddStopWord("кот"s);
+    assert(search_server.FindTopDocuments("кот"s).empty());
+    assert(search_server.FindTopDocuments("ко*"s).empty());
+    assert(search_server.FindTopDocuments("к*"s).empty());
+    assert(search_server.GetWordFrequencies(1).count("кот"s) == 1);
+    search_server.PurgeStopWords();
+    assert(search_server.GetWordFrequencies(1).count("кот"s) == 0);
+    assert(search_server.FindTopDocuments("пушистый"s).size() == 1);
+
+    // удалённое стоп-слово индексируется только в новых документах
+    search_server.RemoveStopWord("кот"s);
+    search_server.RemoveStopWord("и"s);
+    search_server.AddDocument(4, "кот и пёс"s, DocumentStatus::ACTUAL, {4});
+    const auto documents = search_server.FindTopDocuments("кот"s);
+    assert(documents.size() == 1 && documents[0].id == 4);
+    assert(search_server.FindTopDocuments("к*"s).size() == 1);
+    assert(search_server.FindTopDocuments("и"s).size() == 1);
+
+    // снимок не содержит вхождений стоп-слов, даже ещё не удалённых
+    search_server.AddStopWord("пёс"s);
+    stringstream snapshot;
+    search_server.SaveSnapshot(snapshot);
+    const SearchServer loaded = SearchServer::LoadSnapshot(snapshot);
+    assert(loaded.GetWordFrequencies(3).count("пёс"s) == 0);
+    assert(loaded.FindTopDocuments("пёс"s).empty());
+    search_server.RemoveStopWord("пёс"s);
+    assert(search_server.FindTopDocuments("пёс"s).empty());
+    cout << "stop words = "s << search_server.GetMemoryUsage().stop_words << " bytes"s << endl;
+}
+
+// TEST DurableSearchServer
+
+int main() {
+    const string snapshot_path = "/tmp/durable_search_server.snapshot"s;
+    const string log_path = "/tmp/durable_search_server.log"s;
+    remove(snapshot_path.c_str());
+    remove(log_path.c_str());
+
+    mt19937 generator;
+    const auto dictionary = GenerateDictionary(generator, 1000, 10);
+    const auto documents = GenerateQueries(generator, dictionary, 20'000, 70);
+    const auto queries = GenerateQueries(generator, dictionary, 100, 5);
+
+    SearchServer expected(dictionary[0]);
+    {
+        DurableSearchServer durable_server(snapshot_path, log_path, SearchServer(dictionary[0]));
+        for (size_t i = 0; i < documents.size(); ++i) {
+            durable_server.AddDocument(i, documents[i], DocumentStatus::ACTUAL, {1, 2, 3});
+            expected.AddDocument(i, documents[i], DocumentStatus::ACTUAL, {1, 2, 3});
+            if (i == documents.size() / 2) {
+                LOG_DURATION("checkpoint"s);
+                durable_server.Checkpoint();
+            }
+            if (i % 100 == 0) {
+                durable_server.RemoveDocument(i / 2);
+                expected.RemoveDocument(i / 2);
+            }
+        }
+        durable_server.AddStopWord(dictionary[1]);
+        expected.AddStopWord(dictionary[1]);
+        durable_server.AddDocument(documents.size(), documents[0], DocumentStatus::ACTUAL, {1});
+        expected.AddDocument(documents.size(), documents[0], DocumentStatus::ACTUAL, {1});
+    }
+    // недописанная при сбое запись отбрасывается
+    {
+        ofstream log(log_path, ios::binary | ios::app);
+        log << "torn"s;
+    }
+
+    DurableSearchServer recovered(snapshot_path, log_path, SearchServer(dictionary[0]));
+    const auto& stats = recovered.GetRecoveryStats();
+    assert(stats.snapshot_loaded && stats.discarded_bytes == 4);
+    assert(recovered.GetSearchServer().GetDocumentCount() == expected.GetDocumentCount());
+    for (const string& query : queries) {
+        const auto recovered_documents = recovered.GetSearchServer().FindTopDocuments(query);
+        const auto expected_documents = expected.FindTopDocuments(query);
+        assert(recovered_documents.size() == expected_documents.size());
+        for (size_t i = 0; i < expected_documents.size(); ++i) {
+            assert(recovered_documents[i].id == expected_documents[i].id);
+        }
+    }
+    cout << "replayed "s << stats.replayed_records << " records in "s
+         << chrono::duration_cast<chrono::milliseconds>(stats.duration).count() << " ms"s << endl;
+
+    {
+        LOG_DURATION("reindex"s);
+        SearchServer reindexed(dictionary[0]);
+        for (size_t i = 0; i < documents.size(); ++i) {
+            reindexed.AddDocument(i, documents[i], DocumentStatus::ACTUAL, {1, 2, 3});
+        }
+    }
+}
+
+
+// TEST Bm25
+
+string GenerateWord(mt19937& generator, int max_length) {
+    const int length = uniform_int_distribution(1, max_length)(generator);
+    string word;
+    word.reserve(length);
+    for (int i = 0; i < length; ++i) {
+        word.push_back(uniform_int_distribution('a', 'z')(generator));
+    }
+    return word;
+}
+
+vector<string> GenerateDictionary(mt19937& generator, int word_count, int max_length) {
+    vector<string> words;
+    words.reserve(word_count);
+    for (int i = 0; i < word_count; ++i) {
+        words.push_back(GenerateWord(generator, max_length));
+    }
+    sort(words.begin(), words.end());
+    words.erase(unique(words.begin(), words.end()), words.end());
+    return words;
+}
+
+// слово с номером r выбирается с вероятностью, убывающей с r: у частых и редких слов
+// сильно различаются оценки сверху, и отсечение MaxScore срабатывает
+string GenerateQuery(mt19937& generator, const vector<string>& dictionary, int word_count) {
+    string query;
+    for (int i = 0; i < word_count; ++i) {
+        if (!query.empty()) {
+            query.push_back(' ');
+        }
+        const double rank = pow(dictionary.size(), uniform_real_distribution<>(0, 1)(generator)) - 1;
+        query += dictionary[static_cast<size_t>(rank)];
+    }
+    return query;
+}
+
+// документы с равными релевантностью и рейтингом могут идти в любом порядке
+bool HaveSameRanking(const vector<Document>& lhs, const vector<Document>& rhs) {
+    if (lhs.size() != rhs.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < lhs.size(); ++i) {
+        if (abs(lhs[i].relevance - rhs[i].relevance) >= RELEVANCE_EPSILON || lhs[i].rating != rhs[i].rating) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// первые документы с отсечением MaxScore — те же, что первая страница полного ранжирования
+template <typename Ranker, typename DocumentPredicate>
+void CheckPruning(const SearchServer& search_server, const string& query, DocumentPredicate document_predicate) {
+    auto cursor = search_server.FindDocumentPages<Ranker>(query, MAX_RESULT_DOCUMENT_COUNT, document_predicate);
+    const auto page = cursor.NextPage();
+    assert(HaveSameRanking(search_server.FindTopDocuments<Ranker>(query, document_predicate), vector<Document>(page.begin(), page.end())));
+    const auto next_page = cursor.NextPage();
+    assert(HaveSameRanking(search_server.FindTopDocuments<Ranker>(query, document_predicate, 1, MAX_RESULT_DOCUMENT_COUNT),
+                           vector<Document>(next_page.begin(), next_page.end())));
+}
+
+int main() {
+    SearchServer search_server("и в на"s);
+    search_server.AddDocument(1, "белый кот и модный ошейник"s, DocumentStatus::ACTUAL, {8});
+    search_server.AddDocument(2, "пушистый кот пушистый хвост"s, DocumentStatus::ACTUAL, {7});
+    search_server.AddDocument(3, "ухоженный пёс выразительные глаза на длинной длинной морде"s, DocumentStatus::ACTUAL, {5});
+    search_server.AddDocument(4, "кот"s, DocumentStatus::ACTUAL, {1});
+
+    // N = 4, df("кот") = 3, средняя длина 4: idf = ln(1 + 1.5 / 3.5), короткий документ выше
+    const double idf = log(1.0 + 1.5 / 3.5);
+    const auto documents = search_server.FindTopDocuments<Bm25>("кот"s);
+    assert(documents.size() == 3 && documents[0].id == 4);
+    assert(abs(documents[0].relevance - idf * 2.2 / (1.0 + 1.2 * (0.25 + 0.75 / 4))) < RELEVANCE_EPSILON);
+    assert(HaveSameRanking(search_server.FindTopDocuments<Bm25>(execution::par, "пушистый -хвост кот"s),
+                           search_server.FindTopDocuments<Bm25>("пушистый -хвост кот"s)));
+    // по умолчанию TF-IDF
+    assert(HaveSameRanking(search_server.FindTopDocuments("кот"s), search_server.FindTopDocuments<TfIdf>("кот"s)));
+
+    // TF-IDF, N = 10: слова идут в порядке хвост (оценка 1.15), кот (0.80), пёс (0.77). Документ 11
+    // уже в первых двух, и кот должен обновить его запись в куче, а не вытеснить документ 12 (0.40):
+    // иначе порог поднимется до 1.15 и документ 13 с пёс будет отсечён
+    SearchServer pruned_server(""s);
+    pruned_server.AddDocument(11, "кот хвост"s, DocumentStatus::ACTUAL, {1});
+    pruned_server.AddDocument(12, "кот ошейник ошейник ошейник"s, DocumentStatus::ACTUAL, {2});
+    pruned_server.AddDocument(13, "пёс ошейник ошейник"s, DocumentStatus::ACTUAL, {3});
+    for (int id = 14; id < 21; ++id) {
+        pruned_server.AddDocument(id, "ошейник"s, DocumentStatus::ACTUAL, {4});
+    }
+    const auto pruned_documents = pruned_server.FindTopDocuments("хвост кот пёс"s, 0, 2);
+    assert(pruned_documents.size() == 2 && pruned_documents[0].id == 11 && pruned_documents[1].id == 13);
+
+    mt19937 generator;
+    const auto dictionary = GenerateDictionary(generator, 300, 8);
+    vector<string> texts;
+    SearchServer random_server(""s);
+    for (int i = 0; i < 5000; ++i) {
+        texts.push_back(GenerateQuery(generator, dictionary, 3 + i % 50));
+        random_server.AddDocument(i, texts.back(), i % 3 == 0 ? DocumentStatus::BANNED : DocumentStatus::ACTUAL, {i % 11});
+    }
+    for (int i = 0; i < 500; ++i) {
+        string query = GenerateQuery(generator, dictionary, 1 + i % 8);
+        if (i % 5 == 0) {
+            query += " "s + dictionary[i % dictionary.size()].substr(0, 1) + "*"s;
+        }
+        CheckPruning<TfIdf>(random_server, query, ByStatus<DocumentStatus::ACTUAL>());
+        CheckPruning<Bm25>(random_server, query, ByStatus<DocumentStatus::ACTUAL>());
+        CheckPruning<Bm25>(random_server, query, ByStatus<DocumentStatus::BANNED>());
+        CheckPruning<Bm25>(random_server, query, [](int document_id, DocumentStatus, int) {
+            return document_id % 7 == 0;
+        });
+        assert(HaveSameRanking(random_server.FindTopDocuments<Bm25>(execution::par, query), random_server.FindTopDocuments<Bm25>(query)));
+    }
+
+    // длины документов сохраняются в снимке и вычитаются при удалении
+    stringstream snapshot;
+    random_server.SaveSnapshot(snapshot);
+    const SearchServer loaded_server = SearchServer::LoadSnapshot(snapshot);
+    SearchServer trimmed_server(""s);
+    SearchServer removed_server(random_server);
+    for (int i = 0; i < 5000; ++i) {
+        if (i % 2 == 0) {
+            trimmed_server.AddDocument(i, texts[i], i % 3 == 0 ? DocumentStatus::BANNED : DocumentStatus::ACTUAL, {i % 11});
+        } else {
+            removed_server.RemoveDocument(i);
+        }
+    }
+    size_t checked_documents = 0;
+    for (int i = 0; i < 100; ++i) {
+        const string query = GenerateQuery(generator, dictionary, 1 + i % 4);
+        const auto expected = random_server.FindTopDocuments<Bm25>(query);
+        assert(HaveSameRanking(loaded_server.FindTopDocuments<Bm25>(query), expected));
+        assert(HaveSameRanking(removed_server.FindTopDocuments<Bm25>(query), trimmed_server.FindTopDocuments<Bm25>(query)));
+        checked_documents += expected.size();
+    }
+    cout << "bm25 documents checked: "s << checked_documents << endl;
+}
@@ -0,0 +1,188 @@
+#include "thread_pool.h"
+
+#include <stdexcept>
+#ifdef __linux__
+#include <pthread.h>
+#endif
+
+using namespace std::string_literals;
+
+namespace {
+
+thread_local size_t current_worker_index = SIZE_MAX;
+thread_local const void* current_pool = nullptr;
+
+void SetThreadAffinity([[maybe_unused]] std::thread& thread, [[maybe_unused]] int cpu) {
+#ifdef __linux__
+	cpu_set_t cpu_set;
+	CPU_ZERO(&cpu_set);
+	CPU_SET(cpu, &cpu_set);
+	pthread_setaffinity_np(thread.native_handle(), sizeof(cpu_set), &cpu_set);
+#endif
+}
+
+}
+
+ThreadPool::ThreadPool(const Options& options)
+: options_(options)
+, max_queued_tasks_(std::max<size_t>(options.max_queued_tasks, 1)) {
+	if (options.thread_count == 0) {
+		throw std::invalid_argument("Thread pool needs at least one thread"s);
+	}
+	for (size_t i = 0; i < options.thread_count; ++i) {
+		workers_.push_back(std::make_unique<Worker>());
+	}
+	for (size_t i = 0; i < options.thread_count; ++i) {
+		threads_.emplace_back([this, i] {
+			Run(i);
+		});
+		if (!options.cpu_affinity.empty()) {
+			SetThreadAffinity(threads_.back(), options.cpu_affinity[i % options.cpu_affinity.size()]);
+		}
+	}
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard guard(mutex_);
+		stopping_ = true;
+	}
+	has_tasks_.notify_all();
+	has_space_.notify_all();
+	for (auto& thread : threads_) {
+		thread.join();
+	}
+}
+
+void ThreadPool::Submit(Task task) {
+	// задача, поставленная из потока пула, не ждёт места: иначе все потоки могут заблокировать друг друга.
+	// При остановке такие задачи ещё принимаются — поток, поставивший задачу, сам её и выполнит
+	if (current_pool == this) {
+		++queued_tasks_;
+	} else if (stopping_) {
+		throw std::logic_error("Thread pool is stopping"s);
+	} else if (!TryReserveSpace()) {
+		std::unique_lock lock(mutex_);
+		++space_waiters_;
+		bool reserved = false;
+		has_space_.wait(lock, [this, &reserved] {
+			reserved = TryReserveSpace();
+			return reserved || stopping_;
+		});
+		--space_waiters_;
+		if (!reserved) {
+			throw std::logic_error("Thread pool is stopping"s);
+		}
+	}
+	Push(std::move(task));
+}
+
+bool ThreadPool::TrySubmit(Task task) {
+	if (stopping_ || !TryReserveSpace()) {
+		return false;
+	}
+	Push(std::move(task));
+	return true;
+}
+
+size_t ThreadPool::GetThreadCount() const {
+	return threads_.size();
+}
+
+size_t ThreadPool::GetQueuedTaskCount() const {
+	return queued_tasks_;
+}
+
+const ThreadPool::Options& ThreadPool::GetOptions() const {
+	return options_;
+}
+
+bool ThreadPool::TryReserveSpace() {
+	size_t queued = queued_tasks_.load();
+	while (queued < max_queued_tasks_) {
+		if (queued_tasks_.compare_exchange_weak(queued, queued + 1)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+bool ThreadPool::TryTakeTask() {
+	size_t ready = ready_tasks_.load();
+	while (ready > 0) {
+		if (ready_tasks_.compare_exchange_weak(ready, ready - 1)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+// место в очереди уже зарезервировано. Блокируется только очередь выбранного потока;
+// mutex_ — лишь если есть спящие потоки. Увеличение ready_tasks_ и чтение idle_workers_
+// упорядочены с увеличением idle_workers_ и проверкой ready_tasks_ в Run, поэтому оповещение
+// не теряется
+void ThreadPool::Push(Task task) {
+	const size_t index = current_pool == this ? current_worker_index : next_worker_++ % workers_.size();
+	Worker& worker = *workers_[index];
+	{
+		std::lock_guard guard(worker.mutex);
+		worker.tasks.push_back(std::move(task));
+	}
+	++ready_tasks_;
+	if (idle_workers_ > 0) {
+		{
+			std::lock_guard guard(mutex_);
+		}
+		has_tasks_.notify_one();
+	}
+}
+
+// к моменту вызова задача уже зарезервирована уменьшением ready_tasks_ и лежит в одной
+// из очередей, поэтому поиск конечен
+ThreadPool::Task ThreadPool::Pop(size_t index) {
+	for (size_t attempt = 0;; ++attempt) {
+		Worker& worker = *workers_[(index + attempt) % workers_.size()];
+		std::lock_guard guard(worker.mutex);
+		if (worker.tasks.empty()) {
+			continue;
+		}
+		Task task;
+		if (attempt == 0) {
+			task = std::move(worker.tasks.front());
+			worker.tasks.pop_front();
+		} else {
+			task = std::move(worker.tasks.back());
+			worker.tasks.pop_back();
+		}
+		return task;
+	}
+}
+
+void ThreadPool::Run(size_t index) {
+	current_worker_index = index;
+	current_pool = this;
+	while (true) {
+		if (!TryTakeTask()) {
+			std::unique_lock lock(mutex_);
+			++idle_workers_;
+			bool taken = false;
+			has_tasks_.wait(lock, [this, &taken] {
+				taken = TryTakeTask();
+				return taken || stopping_;
+			});
+			--idle_workers_;
+			if (!taken) {
+				return;
+			}
+		}
+		Task task = Pop(index);
+		--queued_tasks_;
+		if (space_waiters_ > 0) {
+			{
+				std::lock_guard guard(mutex_);
+			}
+			has_space_.notify_one();
+		}
+		task();
+	}
+}
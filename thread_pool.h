@@ -0,0 +1,70 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Пул с фиксированным числом потоков: у каждого потока своя очередь под своей блокировкой,
+// свободный поток забирает задачи с хвоста чужих очередей. Общее число ожидающих задач
+// ограничено. Общий mutex_ нужен только для засыпания потоков и ожидания места в очереди.
+class ThreadPool {
+public:
+	using Task = std::function<void()>;
+
+	struct Options {
+		size_t thread_count = std::max(1u, std::thread::hardware_concurrency());
+		size_t max_queued_tasks = 1024;
+		// поток i привязывается к ядру cpu_affinity[i % size]; пустой список — без привязки
+		std::vector<int> cpu_affinity;
+	};
+
+	explicit ThreadPool(const Options& options);
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+	~ThreadPool();
+
+	// блокируется, пока очередь заполнена
+	void Submit(Task task);
+	// возвращает false, если очередь заполнена
+	bool TrySubmit(Task task);
+
+	size_t GetThreadCount() const;
+	size_t GetQueuedTaskCount() const;
+	const Options& GetOptions() const;
+
+private:
+	struct Worker {
+		std::deque<Task> tasks;
+		std::mutex mutex;
+	};
+
+	bool TryReserveSpace();
+	bool TryTakeTask();
+	void Push(Task task);
+	Task Pop(size_t index);
+	void Run(size_t index);
+
+	const Options options_;
+	const size_t max_queued_tasks_;
+	std::vector<std::unique_ptr<Worker>> workers_;
+	std::vector<std::thread> threads_;
+	std::mutex mutex_;
+	std::condition_variable has_tasks_;
+	std::condition_variable has_space_;
+	// поставленные и ещё не взятые задачи — для ограничения очереди
+	std::atomic<size_t> queued_tasks_ = 0;
+	// задачи, уже лежащие в очередях потоков и не зарезервированные ни одним потоком
+	std::atomic<size_t> ready_tasks_ = 0;
+	// засыпающие и ждущие места под mutex_: поставщик и поток берут mutex_ для оповещения,
+	// только если кто-то ждёт
+	std::atomic<size_t> idle_workers_ = 0;
+	std::atomic<size_t> space_waiters_ = 0;
+	std::atomic<size_t> next_worker_ = 0;
+	std::atomic<bool> stopping_ = false;
+};
@@ -0,0 +1,206 @@
+#include "write_ahead_log.h"
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <unistd.h>
+
+using namespace std::string_literals;
+
+namespace {
+
+// длина данных, контрольная сумма, номер, тип
+const size_t RECORD_HEADER_SIZE = 4 + 4 + 8 + 1;
+
+// FNV-1a по номеру, типу и данным записи
+uint32_t ComputeChecksum(uint64_t sequence, uint8_t type, std::string_view payload) {
+	uint32_t hash = 2166136261u;
+	const auto Mix = [&hash](const char* data, size_t size) {
+		for (size_t i = 0; i < size; ++i) {
+			hash = (hash ^ static_cast<uint8_t>(data[i])) * 16777619u;
+		}
+	};
+	Mix(reinterpret_cast<const char*>(&sequence), sizeof(sequence));
+	Mix(reinterpret_cast<const char*>(&type), sizeof(type));
+	Mix(payload.data(), payload.size());
+	return hash;
+}
+
+[[noreturn]] void ThrowSystemError(const std::string& action) {
+	throw std::runtime_error(action + ": "s + std::strerror(errno));
+}
+
+void WriteAll(int file, std::string_view data) {
+	while (!data.empty()) {
+		const ssize_t written = write(file, data.data(), data.size());
+		if (written < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			ThrowSystemError("Cannot write log"s);
+		}
+		data.remove_prefix(written);
+	}
+}
+
+}
+
+WriteAheadLog::WriteAheadLog(const std::string& path, size_t size, uint64_t next_sequence, const WalOptions& options)
+: options_(options)
+, next_sequence_(next_sequence)
+, synced_sequence_(next_sequence - 1) {
+	file_ = open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+	if (file_ < 0) {
+		ThrowSystemError("Cannot open log "s + path);
+	}
+	if (ftruncate(file_, size) < 0 || fsync(file_) < 0) {
+		const int error = errno;
+		close(file_);
+		errno = error;
+		ThrowSystemError("Cannot truncate log "s + path);
+	}
+	flusher_ = std::thread([this] {
+		RunFlusher();
+	});
+}
+
+WriteAheadLog::~WriteAheadLog() {
+	{
+		std::lock_guard guard(mutex_);
+		stopping_ = true;
+		has_records_.notify_one();
+	}
+	flusher_.join();
+	close(file_);
+}
+
+uint64_t WriteAheadLog::Append(uint8_t type, std::string_view payload) {
+	std::lock_guard guard(mutex_);
+	ThrowIfFailed();
+	const uint64_t sequence = next_sequence_++;
+	const uint32_t payload_size = payload.size();
+	const uint32_t checksum = ComputeChecksum(sequence, type, payload);
+	buffer_.append(reinterpret_cast<const char*>(&payload_size), sizeof(payload_size));
+	buffer_.append(reinterpret_cast<const char*>(&checksum), sizeof(checksum));
+	buffer_.append(reinterpret_cast<const char*>(&sequence), sizeof(sequence));
+	buffer_.append(reinterpret_cast<const char*>(&type), sizeof(type));
+	buffer_.append(payload);
+	if (buffered_records_++ == 0) {
+		first_buffered_time_ = std::chrono::steady_clock::now();
+		has_records_.notify_one();
+	} else if (buffered_records_ >= options_.sync_batch_size) {
+		has_records_.notify_one();
+	}
+	return sequence;
+}
+
+void WriteAheadLog::WaitForSync(uint64_t sequence) {
+	std::unique_lock lock(mutex_);
+	ThrowIfFailed();
+	if (synced_sequence_ >= sequence) {
+		return;
+	}
+	sync_requested_ = true;
+	has_records_.notify_one();
+	synced_.wait(lock, [this, sequence] {
+		return synced_sequence_ >= sequence || error_;
+	});
+	ThrowIfFailed();
+}
+
+void WriteAheadLog::Sync() {
+	WaitForSync(GetLastSequence());
+}
+
+void WriteAheadLog::Reset() {
+	Sync();
+	std::lock_guard guard(mutex_);
+	if (ftruncate(file_, 0) < 0 || fsync(file_) < 0) {
+		ThrowSystemError("Cannot reset log"s);
+	}
+}
+
+uint64_t WriteAheadLog::GetLastSequence() const {
+	std::lock_guard guard(mutex_);
+	return next_sequence_ - 1;
+}
+
+const WalOptions& WriteAheadLog::GetOptions() const {
+	return options_;
+}
+
+std::vector<WalRecord> WriteAheadLog::ParseRecords(std::string_view data, size_t* valid_size) {
+	std::vector<WalRecord> records;
+	size_t offset = 0;
+	while (data.size() - offset >= RECORD_HEADER_SIZE) {
+		uint32_t payload_size;
+		uint32_t checksum;
+		WalRecord record;
+		const char* header = data.data() + offset;
+		std::memcpy(&payload_size, header, sizeof(payload_size));
+		std::memcpy(&checksum, header + 4, sizeof(checksum));
+		std::memcpy(&record.sequence, header + 8, sizeof(record.sequence));
+		std::memcpy(&record.type, header + 16, sizeof(record.type));
+		if (data.size() - offset - RECORD_HEADER_SIZE < payload_size) {
+			break;
+		}
+		record.payload = data.substr(offset + RECORD_HEADER_SIZE, payload_size);
+		if (ComputeChecksum(record.sequence, record.type, record.payload) != checksum) {
+			break;
+		}
+		records.push_back(record);
+		offset += RECORD_HEADER_SIZE + payload_size;
+	}
+	if (valid_size != nullptr) {
+		*valid_size = offset;
+	}
+	return records;
+}
+
+void WriteAheadLog::RunFlusher() {
+	std::unique_lock lock(mutex_);
+	while (true) {
+		const auto IsReady = [this] {
+			return stopping_ || sync_requested_ || buffered_records_ >= options_.sync_batch_size
+				|| std::chrono::steady_clock::now() >= first_buffered_time_ + options_.sync_interval;
+		};
+		while (buffered_records_ == 0 ? !stopping_ : !IsReady()) {
+			if (buffered_records_ == 0) {
+				has_records_.wait(lock);
+			} else {
+				has_records_.wait_until(lock, first_buffered_time_ + options_.sync_interval);
+			}
+		}
+		if (buffered_records_ == 0) {
+			return;
+		}
+		// пока пачка пишется и синхронизируется, новые записи копятся в следующем буфере
+		const std::string data = std::move(buffer_);
+		buffer_.clear();
+		const uint64_t last_sequence = next_sequence_ - 1;
+		buffered_records_ = 0;
+		sync_requested_ = false;
+		lock.unlock();
+		try {
+			WriteAll(file_, data);
+			if (fdatasync(file_) < 0) {
+				ThrowSystemError("Cannot sync log"s);
+			}
+		} catch (...) {
+			lock.lock();
+			error_ = std::current_exception();
+			synced_.notify_all();
+			return;
+		}
+		lock.lock();
+		synced_sequence_ = last_sequence;
+		synced_.notify_all();
+	}
+}
+
+void WriteAheadLog::ThrowIfFailed() const {
+	if (error_) {
+		std::rethrow_exception(error_);
+	}
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+struct WalOptions {
+	// fsync выполняется, как только накопилось столько записей или прошло sync_interval
+	// с первой несинхронизированной записи — одна fsync на пачку записей
+	size_t sync_batch_size = 256;
+	std::chrono::milliseconds sync_interval{10};
+	// изменение возвращается только после fsync своей записи; иначе при сбое теряется
+	// не больше одной несинхронизированной пачки
+	bool wait_for_sync = false;
+};
+
+struct WalRecord {
+	uint64_t sequence = 0;
+	uint8_t type = 0;
+	std::string_view payload;
+};
+
+// Журнал только на дозапись. Запись: длина данных, контрольная сумма, номер, тип, данные;
+// числа в порядке байт платформы. Append кладёт запись в буфер, фоновый поток пишет буфер
+// в файл и вызывает fsync пачками, поэтому скорость записи не ограничена задержкой fsync.
+class WriteAheadLog {
+public:
+	// size первых байт файла — целые записи (см. ParseRecords), повреждённый хвост обрезается;
+	// номера новых записей начинаются с next_sequence
+	WriteAheadLog(const std::string& path, size_t size, uint64_t next_sequence, const WalOptions& options = WalOptions());
+	WriteAheadLog(const WriteAheadLog&) = delete;
+	WriteAheadLog& operator=(const WriteAheadLog&) = delete;
+	// дописывает и синхронизирует буфер
+	~WriteAheadLog();
+
+	// возвращает номер записи; ошибка записи в файл — std::runtime_error здесь или в Sync
+	uint64_t Append(uint8_t type, std::string_view payload);
+	// ждёт fsync записи с номером sequence; ожидающие одновременно делят одну fsync
+	void WaitForSync(uint64_t sequence);
+	void Sync();
+	// очищает файл после контрольной точки, нумерация записей продолжается
+	void Reset();
+
+	uint64_t GetLastSequence() const;
+	const WalOptions& GetOptions() const;
+
+	// целые записи от начала data до первой неполной или повреждённой — сбой мог прервать
+	// последнюю запись; valid_size получает их общую длину
+	static std::vector<WalRecord> ParseRecords(std::string_view data, size_t* valid_size = nullptr);
+
+private:
+	void RunFlusher();
+	void ThrowIfFailed() const;
+
+	const WalOptions options_;
+	int file_ = -1;
+	mutable std::mutex mutex_;
+	std::condition_variable has_records_;
+	std::condition_variable synced_;
+	std::string buffer_;
+	size_t buffered_records_ = 0;
+	std::chrono::steady_clock::time_point first_buffered_time_;
+	uint64_t next_sequence_;
+	uint64_t synced_sequence_;
+	bool sync_requested_ = false;
+	bool stopping_ = false;
+	std::exception_ptr error_;
+	std::thread flusher_;
+};